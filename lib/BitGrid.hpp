@@ -0,0 +1,375 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace bits
+{
+    /// Number of set bits
+    inline int PopCount(std::uint64_t _word)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(_word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        return static_cast<int>(__popcnt64(_word));
+#else
+        _word = _word - ((_word >> 1) & 0x5555555555555555ULL);
+        _word = (_word & 0x3333333333333333ULL) + ((_word >> 2) & 0x3333333333333333ULL);
+        _word = (_word + (_word >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+        return static_cast<int>((_word * 0x0101010101010101ULL) >> 56);
+#endif
+    }
+
+    /// Index of the lowest set bit, _word must not be zero
+    inline int CountTrailingZeros(std::uint64_t _word)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(_word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, _word);
+        return static_cast<int>(index);
+#else
+        int index = 0;
+        while (!(_word & 1))
+        {
+            _word >>= 1;
+            ++index;
+        }
+        return index;
+#endif
+    }
+
+    /// Mask of the lowest _count bits, _count in [0, 64]
+    inline std::uint64_t LowMask(int _count)
+    {
+        return _count >= 64 ? ~std::uint64_t{ 0 } : (std::uint64_t{ 1 } << _count) - 1;
+    }
+}
+
+/**
+ * Binary voxel grid packed into 64-bit words, one bit per voxel. The voxels
+ * keep the linear order of the grid, bit b of word w is the voxel w * 64 + b.
+ * The iterators behave like those of std::vector<bool>, so the grid can be
+ * used everywhere a voxel iterator is expected. ScaledGeometricalMoments and
+ * ZernikeDescriptor additionally work on whole words for these types
+ * (see IsBitGridIterator).
+ */
+class BitGrid
+{
+public:
+    typedef std::uint64_t Word;
+
+    static const int wordBits = 64;
+
+    /// Proxy of a single voxel
+    class reference
+    {
+    public:
+        reference(Word * _word, Word _mask) : word_(_word), mask_(_mask) {}
+
+        operator bool() const
+        {
+            return (*word_ & mask_) != 0;
+        }
+
+        reference & operator=(bool _value)
+        {
+            if (_value)
+            {
+                *word_ |= mask_;
+            }
+            else
+            {
+                *word_ &= ~mask_;
+            }
+
+            return *this;
+        }
+
+        reference & operator=(const reference & _other)
+        {
+            return *this = static_cast<bool>(_other);
+        }
+
+    private:
+        Word * word_;
+        Word mask_;
+    };
+
+    /**
+     * Random access iterator over the voxels. The const iterator only reads the
+     * words, so it may also run over packed voxels stored elsewhere, e.g. in a
+     * memory-mapped file.
+     */
+    template<bool isConst>
+    class basic_iterator
+    {
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef bool                            value_type;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef void                            pointer;
+        typedef std::conditional_t<isConst, bool, BitGrid::reference>   reference;
+        typedef std::conditional_t<isConst, const Word *, Word *>       WordPointer;
+
+        basic_iterator() : words_(nullptr), index_(0) {}
+        basic_iterator(WordPointer _words, std::size_t _index) : words_(_words), index_(_index) {}
+
+        /// the mutable iterator converts to the const one
+        template<bool otherConst, class = std::enable_if_t<isConst && !otherConst>>
+        basic_iterator(const basic_iterator<otherConst> & _other) : words_(_other.GetWords()), index_(_other.GetIndex()) {}
+
+        reference operator*() const
+        {
+            return Dereference(words_ + index_ / wordBits, Word{ 1 } << (index_ % wordBits));
+        }
+
+        reference operator[](difference_type _offset) const
+        {
+            return *(*this + _offset);
+        }
+
+        basic_iterator & operator++() { ++index_; return *this; }
+        basic_iterator & operator--() { --index_; return *this; }
+        basic_iterator operator++(int) { basic_iterator old(*this); ++index_; return old; }
+        basic_iterator operator--(int) { basic_iterator old(*this); --index_; return old; }
+
+        basic_iterator & operator+=(difference_type _offset) { index_ += _offset; return *this; }
+        basic_iterator & operator-=(difference_type _offset) { index_ -= _offset; return *this; }
+
+        basic_iterator operator+(difference_type _offset) const { return basic_iterator(words_, index_ + _offset); }
+        basic_iterator operator-(difference_type _offset) const { return basic_iterator(words_, index_ - _offset); }
+
+        difference_type operator-(const basic_iterator & _other) const
+        {
+            return static_cast<difference_type>(index_) - static_cast<difference_type>(_other.index_);
+        }
+
+        bool operator==(const basic_iterator & _other) const { return index_ == _other.index_ && words_ == _other.words_; }
+        bool operator!=(const basic_iterator & _other) const { return !(*this == _other); }
+        bool operator<(const basic_iterator & _other) const { return index_ < _other.index_; }
+        bool operator>(const basic_iterator & _other) const { return index_ > _other.index_; }
+        bool operator<=(const basic_iterator & _other) const { return index_ <= _other.index_; }
+        bool operator>=(const basic_iterator & _other) const { return index_ >= _other.index_; }
+
+        /// Up to 64 voxels starting at the iterator, voxel i is bit i
+        Word GetBits(std::size_t _offset, int _count) const
+        {
+            return BitGrid::GetBits(words_, index_ + _offset, _count);
+        }
+
+        WordPointer GetWords() const
+        {
+            return words_;
+        }
+
+        std::size_t GetIndex() const
+        {
+            return index_;
+        }
+
+    private:
+        WordPointer     words_;
+        std::size_t     index_;
+
+        static bool Dereference(const Word * _word, Word _mask)
+        {
+            return (*_word & _mask) != 0;
+        }
+
+        static BitGrid::reference Dereference(Word * _word, Word _mask)
+        {
+            return BitGrid::reference(_word, _mask);
+        }
+    };
+
+    typedef basic_iterator<false>   iterator;
+    typedef basic_iterator<true>    const_iterator;
+
+    BitGrid() : size_(0) {}
+
+    explicit BitGrid(std::size_t _size) : words_(WordCount(_size)), size_(_size) {}
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    /// Resizes the grid, all voxels are cleared
+    void resize(std::size_t _size)
+    {
+        words_.assign(WordCount(_size), 0);
+        size_ = _size;
+    }
+
+    iterator begin()
+    {
+        return iterator(words_.data(), 0);
+    }
+
+    iterator end()
+    {
+        return iterator(words_.data(), size_);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(words_.data(), 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(words_.data(), size_);
+    }
+
+    const_iterator cbegin() const
+    {
+        return begin();
+    }
+
+    const_iterator cend() const
+    {
+        return end();
+    }
+
+    bool operator[](std::size_t _index) const
+    {
+        return (words_[_index / wordBits] >> (_index % wordBits)) & 1;
+    }
+
+    reference operator[](std::size_t _index)
+    {
+        return *(begin() + _index);
+    }
+
+    /// Sets the voxels [_begin, _end)
+    void SetRange(std::size_t _begin, std::size_t _end)
+    {
+        ForEachWord(words_.data(), _begin, _end, [](Word & _word, Word _mask) { _word |= _mask; });
+    }
+
+    /// Clears the voxels [_begin, _end)
+    void ClearRange(std::size_t _begin, std::size_t _end)
+    {
+        ForEachWord(words_.data(), _begin, _end, [](Word & _word, Word _mask) { _word &= ~_mask; });
+    }
+
+    /// Number of set voxels
+    std::size_t Count() const
+    {
+        std::size_t count = 0;
+        for (Word word : words_)
+        {
+            count += bits::PopCount(word);
+        }
+
+        return count;
+    }
+
+    const std::vector<Word> & GetWords() const
+    {
+        return words_;
+    }
+
+    static std::size_t WordCount(std::size_t _size)
+    {
+        return (_size + wordBits - 1) / wordBits;
+    }
+
+    /// _count <= 64 bits starting at the bit _index of _words, bit 0 of the result is the first one
+    static Word GetBits(const Word * _words, std::size_t _index, int _count)
+    {
+        std::size_t word = _index / wordBits;
+        int shift = static_cast<int>(_index % wordBits);
+
+        Word result = _words[word] >> shift;
+
+        if (shift != 0 && shift + _count > wordBits)
+        {
+            result |= _words[word + 1] << (wordBits - shift);
+        }
+
+        return result & bits::LowMask(_count);
+    }
+
+private:
+    std::vector<Word>   words_;
+    std::size_t         size_;
+
+    /// Calls _function(word, mask) for the words covering the bits [_begin, _end)
+    template<class Function>
+    static void ForEachWord(Word * _words, std::size_t _begin, std::size_t _end, Function _function)
+    {
+        while (_begin < _end)
+        {
+            std::size_t word = _begin / wordBits;
+            int shift = static_cast<int>(_begin % wordBits);
+            int count = static_cast<int>(std::min<std::size_t>(wordBits - shift, _end - _begin));
+
+            _function(_words[word], bits::LowMask(count) << shift);
+
+            _begin += count;
+        }
+    }
+};
+
+/// True for the iterators of BitGrid, whose voxels can be read word by word
+template<class Iterator>
+struct IsBitGridIterator : std::false_type
+{
+};
+
+template<bool isConst>
+struct IsBitGridIterator<BitGrid::basic_iterator<isConst>> : std::true_type
+{
+};
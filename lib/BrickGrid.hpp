@@ -0,0 +1,284 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ----- local program includes -----
+#include "BitGrid.hpp"
+
+/**
+ * Sparse binary voxel grid made of bricks of 8^3 voxels. An occupancy index
+ * marks each brick as empty, full or mixed, only mixed bricks store their
+ * voxels. A mixed brick has one 64-bit word per layer z, bit y * 8 + x of
+ * it is the voxel (x, y) of the layer. Bricks at the upper ends of a grid
+ * whose dimension is not a multiple of 8 are cut, the voxels beyond the
+ * grid are never set. See BrickMoments for the moments of such grids.
+ */
+class BrickGrid
+{
+public:
+    typedef std::uint64_t Word;
+
+    /// Voxels along each axis of a brick
+    static const int brickDim = 8;
+
+    enum class BrickState
+    {
+        empty,
+        full,
+        mixed
+    };
+
+    /// Voxels of a mixed brick
+    struct Brick
+    {
+        Word layers_[brickDim];
+    };
+
+    /// Empty grid of _dim^3 voxels
+    explicit BrickGrid(std::size_t _dim) : dim_(_dim), bricksDim_((_dim + brickDim - 1) / brickDim)
+    {
+        index_.assign(bricksDim_ * bricksDim_ * bricksDim_, emptyBrick);
+    }
+
+    /**
+     * Grid from a dense voxel grid in the order (z * _dim + y) * _dim + x,
+     * non-zero voxels are set. Full bricks are found afterwards (see Compact()).
+     */
+    template<class InputVoxelIterator>
+    BrickGrid(InputVoxelIterator _voxels, std::size_t _dim) : BrickGrid(_dim)
+    {
+        for (std::size_t z = 0; z < dim_; ++z)
+        {
+            for (std::size_t y = 0; y < dim_; ++y)
+            {
+                for (std::size_t x = 0; x < dim_; ++x, ++_voxels)
+                {
+                    if (*_voxels)
+                    {
+                        Set(x, y, z, true);
+                    }
+                }
+            }
+        }
+
+        Compact();
+    }
+
+    std::size_t GetDim() const
+    {
+        return dim_;
+    }
+
+    /// Number of bricks along each axis
+    std::size_t GetBricksDim() const
+    {
+        return bricksDim_;
+    }
+
+    bool Get(std::size_t _x, std::size_t _y, std::size_t _z) const
+    {
+        std::int32_t index = index_[BrickIndex(_x / brickDim, _y / brickDim, _z / brickDim)];
+
+        if (index < 0)
+        {
+            return index == fullBrick;
+        }
+
+        return (bricks_[index].layers_[_z % brickDim] >> BitIndex(_x, _y)) & 1;
+    }
+
+    /// Sets a voxel, a full or empty brick becomes mixed if the voxel changes
+    void Set(std::size_t _x, std::size_t _y, std::size_t _z, bool _value)
+    {
+        std::int32_t & index = index_[BrickIndex(_x / brickDim, _y / brickDim, _z / brickDim)];
+
+        if (index == (_value ? fullBrick : emptyBrick))
+        {
+            return;
+        }
+
+        if (index < 0)
+        {
+            std::size_t bx = _x / brickDim, by = _y / brickDim, bz = _z / brickDim;
+
+            // a full brick sets only the voxels inside the grid
+            Brick brick{};
+
+            if (index == fullBrick)
+            {
+                for (int z = 0; z < Extent(bz); ++z)
+                {
+                    brick.layers_[z] = LayerMask(bx, by);
+                }
+            }
+
+            index = static_cast<std::int32_t>(bricks_.size());
+            bricks_.push_back(brick);
+        }
+
+        Word & layer = bricks_[index].layers_[_z % brickDim];
+        Word mask = Word{ 1 } << BitIndex(_x, _y);
+
+        layer = _value ? layer | mask : layer & ~mask;
+    }
+
+    /**
+     * Marks mixed bricks without voxels as empty and those with all voxels inside
+     * the grid set as full, the storage of the mixed bricks is packed.
+     */
+    void Compact()
+    {
+        std::vector<Brick> bricks;
+
+        for (std::size_t bz = 0; bz < bricksDim_; ++bz)
+        {
+            for (std::size_t by = 0; by < bricksDim_; ++by)
+            {
+                for (std::size_t bx = 0; bx < bricksDim_; ++bx)
+                {
+                    std::int32_t & index = index_[BrickIndex(bx, by, bz)];
+
+                    if (index < 0)
+                    {
+                        continue;
+                    }
+
+                    const Brick & brick = bricks_[index];
+                    bool isEmpty = true, isFull = true;
+
+                    for (int z = 0; z < brickDim; ++z)
+                    {
+                        Word mask = z < Extent(bz) ? LayerMask(bx, by) : 0;
+
+                        isEmpty &= (brick.layers_[z] & mask) == 0;
+                        isFull &= (brick.layers_[z] & mask) == mask;
+                    }
+
+                    if (isEmpty || isFull)
+                    {
+                        index = isEmpty ? emptyBrick : fullBrick;
+                    }
+                    else
+                    {
+                        index = static_cast<std::int32_t>(bricks.size());
+                        bricks.push_back(brick);
+                    }
+                }
+            }
+        }
+
+        bricks_.swap(bricks);
+    }
+
+    BrickState GetState(std::size_t _bx, std::size_t _by, std::size_t _bz) const
+    {
+        std::int32_t index = index_[BrickIndex(_bx, _by, _bz)];
+
+        return index == emptyBrick ? BrickState::empty : (index == fullBrick ? BrickState::full : BrickState::mixed);
+    }
+
+    /// Voxels of a mixed brick
+    const Brick & GetBrick(std::size_t _bx, std::size_t _by, std::size_t _bz) const
+    {
+        return bricks_[index_[BrickIndex(_bx, _by, _bz)]];
+    }
+
+    /// Number of voxels of the brick _b along an axis, less than brickDim at the upper end of a cut grid
+    int Extent(std::size_t _b) const
+    {
+        return static_cast<int>(std::min<std::size_t>(brickDim, dim_ - _b * brickDim));
+    }
+
+    /// Number of mixed bricks
+    std::size_t GetMixedCount() const
+    {
+        return bricks_.size();
+    }
+
+    /// Voxels of the line _y of a layer of a brick, bit x is the voxel x
+    static unsigned GetLine(Word _layer, int _y)
+    {
+        return static_cast<unsigned>((_layer >> (_y * brickDim)) & 0xff);
+    }
+
+private:
+    // entries of the occupancy index besides the indices of mixed bricks
+    enum : std::int32_t
+    {
+        emptyBrick = -1,
+        fullBrick = -2
+    };
+
+    std::size_t             dim_;       // dimension of the grid
+    std::size_t             bricksDim_; // bricks along each axis
+    std::vector<std::int32_t> index_;   // empty, full or the index of a mixed brick in the order (bz, by, bx)
+    std::vector<Brick>      bricks_;    // voxels of the mixed bricks
+
+    std::size_t BrickIndex(std::size_t _bx, std::size_t _by, std::size_t _bz) const
+    {
+        return (_bz * bricksDim_ + _by) * bricksDim_ + _bx;
+    }
+
+    static int BitIndex(std::size_t _x, std::size_t _y)
+    {
+        return static_cast<int>((_y % brickDim) * brickDim + _x % brickDim);
+    }
+
+    /// Bits of a brick layer inside the grid
+    Word LayerMask(std::size_t _bx, std::size_t _by) const
+    {
+        Word line = bits::LowMask(Extent(_bx));
+        Word mask = 0;
+
+        for (int y = 0; y < Extent(_by); ++y)
+        {
+            mask |= line << (y * brickDim);
+        }
+
+        return mask;
+    }
+};
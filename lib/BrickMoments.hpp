@@ -0,0 +1,435 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// ----- local program includes -----
+#include "BrickGrid.hpp"
+#include "ScaledGeometricMoments.hpp"
+
+/**
+    Class for computing the scaled, pre-integrated geometrical moments (see
+    ScaledGeometricalMoments) of a sparse BrickGrid. Empty bricks are skipped,
+    full bricks are integrated in closed form as boxes and mixed bricks line by
+    line from the runs of their bits. The cost is proportional to the number of
+    occupied bricks and not to the size of the grid.
+    \param MomentT  type of the moments -- recommended to be double
+ */
+template<class MomentT>
+class BrickMoments
+{
+public:
+    // ---- public typedefs ----
+    /// the moment type
+    typedef MomentT             T;
+    /// vector scalar type
+    typedef vector<T>           T1D;
+
+    // ---- construction / init ----
+    /// Contructor
+    BrickMoments(
+        const BrickGrid & _grid                 /**< the sparse voxel grid */
+    ) : grid_(&_grid), dim_(static_cast<int>(_grid.GetDim())), maxOrder_(0)
+    {
+    }
+
+    /**
+        Computes the sums over all occupied voxels needed for the normalization
+     */
+    VoxelSums ComputeSums() const
+    {
+        VoxelSums sums;
+
+        ForEachBrick([&](std::uint64_t _x0, std::uint64_t _y0, std::uint64_t _z0, const int _extent[3], const BrickGrid::Brick * _brick)
+        {
+            if (!_brick)
+            {
+                // a box adds the sums along one axis times the number of voxels of the other two
+                std::uint64_t origin[3] = { _x0, _y0, _z0 };
+                std::uint64_t count = static_cast<std::uint64_t>(_extent[0]) * _extent[1] * _extent[2];
+
+                sums.count_ += count;
+
+                for (int n = 0; n < 3; ++n)
+                {
+                    std::uint64_t begin = origin[n], end = origin[n] + _extent[n];
+                    std::uint64_t rest = count / _extent[n];
+
+                    sums.sum_[n] += rest * (begin + end - 1) * _extent[n] / 2;
+                    sums.sqrSum_[n] += rest * (SumOfSquares(end) - SumOfSquares(begin));
+                }
+
+                return;
+            }
+
+            for (int z = 0; z < _extent[2]; ++z)
+            {
+                for (int y = 0; y < _extent[1]; ++y)
+                {
+                    unsigned line = BrickGrid::GetLine(_brick->layers_[z], y) & static_cast<unsigned>(bits::LowMask(_extent[0]));
+                    std::uint64_t count = bits::PopCount(line);
+
+                    sums.count_ += count;
+                    sums.sum_[1] += (_y0 + y) * count;
+                    sums.sum_[2] += (_z0 + z) * count;
+                    sums.sqrSum_[1] += (_y0 + y) * (_y0 + y) * count;
+                    sums.sqrSum_[2] += (_z0 + z) * (_z0 + z) * count;
+
+                    for (; line; line &= line - 1)
+                    {
+                        std::uint64_t x = _x0 + bits::CountTrailingZeros(line);
+
+                        sums.sum_[0] += x;
+                        sums.sqrSum_[0] += x * x;
+                    }
+                }
+            }
+        });
+
+        return sums;
+    }
+
+    /**
+        Computes the moments up to _maxOrder of the grid translated by the center of gravity
+        and scaled by _scale. Voxels whose centers are farther from the center of gravity
+        than sqrt(_sqrRadius) are skipped, i.e. the grid may be cut off by a ball. Full
+        bricks inside the ball are boxes, the other ones are clipped line by line.
+     */
+    void Compute(
+        T _xCOG,                /**< x-coord of the center of gravity */
+        T _yCOG,                /**< y-coord of the center of gravity */
+        T _zCOG,                /**< z-coord of the center of gravity */
+        T _scale,               /**< scaling factor */
+        int _maxOrder,          /**< maximal order to compute moments for */
+        T _sqrRadius = std::numeric_limits<T>::infinity()  /**< squared radius of the cut off ball */
+    )
+    {
+        static_assert(std::is_floating_point<T>::value, "MomentT must be float, double or long double");
+
+        maxOrder_ = _maxOrder;
+
+        const int nOrders = maxOrder_ + 1;
+        const int brickDim = BrickGrid::brickDim;
+
+        ComputeSamplePowers(_xCOG, _scale, dim_, maxOrder_, xPowers_);
+        ComputeSamplePowers(_yCOG, _scale, dim_, maxOrder_, yPowers_);
+        ComputeSamplePowers(_zCOG, _scale, dim_, maxOrder_, zPowers_);
+
+        moments_.assign(GeometricalMomentCount(maxOrder_), static_cast<T>(0));
+
+        const bool cutOff = _sqrRadius < std::numeric_limits<T>::infinity();
+
+        // moments along x and y for (i, j) of the boxes of a brick layer and of its single layers z
+        T1D boxes(nOrders * nOrders);
+        vector<T1D> layers(brickDim, T1D(nOrders * nOrders));
+        T1D line(nOrders);
+
+        bool isBoxes = false;
+        bool isLayer[brickDim] = {};
+        long long layerZ = -1;
+
+        auto flushLayers = [&]()
+        {
+            int zExtent = grid_->Extent(layerZ / brickDim);
+
+            if (isBoxes)
+            {
+                AddLayer(boxes, Integrals(zPowers_, layerZ, layerZ + zExtent));
+                std::fill(boxes.begin(), boxes.end(), static_cast<T>(0));
+                isBoxes = false;
+            }
+
+            for (int z = 0; z < zExtent; ++z)
+            {
+                if (isLayer[z])
+                {
+                    AddLayer(layers[z], Integrals(zPowers_, layerZ + z, layerZ + z + 1));
+                    std::fill(layers[z].begin(), layers[z].end(), static_cast<T>(0));
+                    isLayer[z] = false;
+                }
+            }
+        };
+
+        ForEachBrick([&](long long _x0, long long _y0, long long _z0, const int _extent[3], const BrickGrid::Brick * _brick)
+        {
+            if (_z0 != layerZ)
+            {
+                if (layerZ >= 0)
+                {
+                    flushLayers();
+                }
+
+                layerZ = _z0;
+            }
+
+            if (!_brick && (!cutOff || IsInsideBall(_x0, _y0, _z0, _extent, _xCOG, _yCOG, _zCOG, _sqrRadius)))
+            {
+                AddOuter(boxes, Integrals(xPowers_, _x0, _x0 + _extent[0]), Integrals(yPowers_, _y0, _y0 + _extent[1]));
+                isBoxes = true;
+                return;
+            }
+
+            unsigned extentMask = static_cast<unsigned>(bits::LowMask(_extent[0]));
+
+            for (int z = 0; z < _extent[2]; ++z)
+            {
+                for (int y = 0; y < _extent[1]; ++y)
+                {
+                    unsigned voxels = _brick ? BrickGrid::GetLine(_brick->layers_[z], y) & extentMask : extentMask;
+
+                    if (!voxels)
+                    {
+                        continue;
+                    }
+
+                    if (cutOff)
+                    {
+                        long long begin = _x0, end = _x0 + _extent[0];
+
+                        T py = static_cast<T>(_y0 + y) - _yCOG;
+                        T pz = static_cast<T>(_z0 + z) - _zCOG;
+
+                        // the same test as for single voxels
+                        auto inside = [&](long long _x)
+                        {
+                            T px = static_cast<T>(_x) - _xCOG;
+                            return px * px + py * py + pz * pz <= _sqrRadius;
+                        };
+
+                        ClipToChord(begin, end, _xCOG, _sqrRadius - py * py - pz * pz, inside);
+
+                        voxels &= static_cast<unsigned>(bits::LowMask(static_cast<int>(end - _x0)) & ~bits::LowMask(static_cast<int>(begin - _x0)));
+
+                        if (begin >= end || !voxels)
+                        {
+                            continue;
+                        }
+                    }
+
+                    // the integral over a run is the difference of the powers at its ends
+                    std::fill(line.begin(), line.end(), static_cast<T>(0));
+
+                    for (unsigned changes = voxels ^ (voxels << 1); changes; changes &= changes - 1)
+                    {
+                        int bit = bits::CountTrailingZeros(changes);
+                        const T * powers = &xPowers_[(_x0 + bit) * nOrders];
+                        T sign = ((voxels >> bit) & 1) ? static_cast<T>(-1) : static_cast<T>(1);
+
+                        for (int i = 0; i < nOrders; ++i)
+                        {
+                            line[i] += sign * powers[i];
+                        }
+                    }
+
+                    AddOuter(layers[z], line, Integrals(yPowers_, _y0 + y, _y0 + y + 1));
+                    isLayer[z] = true;
+                }
+            }
+        });
+
+        if (layerZ >= 0)
+        {
+            flushLayers();
+        }
+
+        typename T1D::iterator momentIter = moments_.begin();
+
+        for (int i = 0; i < nOrders; ++i)
+        {
+            for (int j = 0; j < nOrders - i; ++j)
+            {
+                for (int k = 0; k < nOrders - i - j; ++k)
+                {
+                    *momentIter++ /= static_cast<T>((1 + i) * (1 + j) * (1 + k));
+                }
+            }
+        }
+    }
+
+    /// Access function
+    T GetMoment(
+        int _i,                 /**< order along x */
+        int _j,                 /**< order along y */
+        int _k                  /**< order along z */
+    ) const
+    {
+        return moments_[GeometricalMomentIndex(_i, _j, _k, maxOrder_)];
+    }
+
+    /// All moments in the flat tetrahedral order, see GeometricalMomentIndex()
+    const T1D & GetMoments() const
+    {
+        return moments_;
+    }
+
+    int GetMaxOrder() const
+    {
+        return maxOrder_;
+    }
+
+private:
+    const BrickGrid * grid_;            // the voxel grid
+    int         dim_,                   // dimension of the grid
+                maxOrder_;              // maximal order of the moments
+
+    T1D         xPowers_,               // powers 1..maxOrder_+1 of the samples in x, y, z
+                yPowers_,
+                zPowers_;
+    T1D         moments_;               // flat tetrahedral array containing the moments
+
+    // ---- private functions ----
+    /**
+        Calls _function(x0, y0, z0, extent, brick) for the non-empty bricks in the order of
+        the layers of bricks, brick is null for full bricks.
+     */
+    template<class Function>
+    void ForEachBrick(Function _function) const
+    {
+        const std::size_t bricksDim = grid_->GetBricksDim();
+        const int brickDim = BrickGrid::brickDim;
+
+        for (std::size_t bz = 0; bz < bricksDim; ++bz)
+        {
+            for (std::size_t by = 0; by < bricksDim; ++by)
+            {
+                for (std::size_t bx = 0; bx < bricksDim; ++bx)
+                {
+                    BrickGrid::BrickState state = grid_->GetState(bx, by, bz);
+
+                    if (state == BrickGrid::BrickState::empty)
+                    {
+                        continue;
+                    }
+
+                    int extent[3] = { grid_->Extent(bx), grid_->Extent(by), grid_->Extent(bz) };
+
+                    _function(bx * brickDim, by * brickDim, bz * brickDim, extent,
+                        state == BrickGrid::BrickState::full ? nullptr : &grid_->GetBrick(bx, by, bz));
+                }
+            }
+        }
+    }
+
+    /**
+        Tests the corner of a box farthest from the center of gravity in the same way as
+        single voxels. The test is monotonous in the distances, so all voxels pass if it does.
+     */
+    static bool IsInsideBall(long long _x0, long long _y0, long long _z0, const int _extent[3], T _xCOG, T _yCOG, T _zCOG, T _sqrRadius)
+    {
+        long long origin[3] = { _x0, _y0, _z0 };
+        T cog[3] = { _xCOG, _yCOG, _zCOG };
+        T p[3];
+
+        for (int n = 0; n < 3; ++n)
+        {
+            T lower = static_cast<T>(origin[n]) - cog[n];
+            T upper = static_cast<T>(origin[n] + _extent[n] - 1) - cog[n];
+
+            p[n] = std::max(std::abs(lower), std::abs(upper));
+        }
+
+        return p[0] * p[0] + p[1] * p[1] + p[2] * p[2] <= _sqrRadius;
+    }
+
+    /// Integrals of the powers over the voxels [_begin, _end) times (i + 1)
+    T1D Integrals(const T1D & _powers, long long _begin, long long _end) const
+    {
+        const int nOrders = maxOrder_ + 1;
+
+        T1D integrals(nOrders);
+
+        for (int i = 0; i < nOrders; ++i)
+        {
+            integrals[i] = _powers[_end * nOrders + i] - _powers[_begin * nOrders + i];
+        }
+
+        return integrals;
+    }
+
+    /// Adds the outer product of the integrals along x and y for i + j <= maxOrder_
+    void AddOuter(T1D & _layer, const T1D & _x, const T1D & _y) const
+    {
+        const int nOrders = maxOrder_ + 1;
+
+        for (int i = 0; i < nOrders; ++i)
+        {
+            for (int j = 0; j < nOrders - i; ++j)
+            {
+                _layer[i * nOrders + j] += _x[i] * _y[j];
+            }
+        }
+    }
+
+    /// Adds the moments of a layer along x and y times the integrals along z
+    void AddLayer(const T1D & _layer, const T1D & _z)
+    {
+        const int nOrders = maxOrder_ + 1;
+
+        typename T1D::iterator momentIter = moments_.begin();
+
+        for (int i = 0; i < nOrders; ++i)
+        {
+            for (int j = 0; j < nOrders - i; ++j)
+            {
+                T moment = _layer[i * nOrders + j];
+
+                for (int k = 0; k < nOrders - i - j; ++k)
+                {
+                    *momentIter++ += moment * _z[k];
+                }
+            }
+        }
+    }
+
+    /// Sum of x^2 for x in [0, _end)
+    static std::uint64_t SumOfSquares(std::uint64_t _end)
+    {
+        return _end == 0 ? 0 : (_end - 1) * _end * (2 * _end - 1) / 6;
+    }
+};
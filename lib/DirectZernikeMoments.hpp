@@ -0,0 +1,452 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include <boost/math/constants/constants.hpp>
+
+// ----- local program includes -----
+#include "ParallelFor.hpp"
+#include "ScaledGeometricMoments.hpp"
+#include "ZernikeCoefficients.hpp"
+
+/**
+    Class computing the Zernike moments of a voxel grid directly, i.e. without the
+    geometrical moments and without the coefficient table of ZernikeCoefficients.
+    The Zernike polynomial [n,l,m] of the table is
+
+        Z_nlm(x) = sqrt((2n + 3) / 3) * P_k(2 r^2 - 1) * i^m * S_lm(x),   k = (n - l) / 2,
+
+    where P_k is the Jacobi polynomial P_k^(0, l + 1/2) and S_lm = r^l Pbar_l^m(z / r) e^(i m phi)
+    is the solid harmonic with the associated Legendre function Pbar_l^m normalized to an
+    integral of 2 over [-1, 1] (no Condon-Shortley phase). Both are evaluated by their
+    three-term recurrences, which are stable, so there is no cancellation of large
+    coefficients as in the expansion into geometrical moments and high orders stay accurate.
+    A voxel is sampled at its center and costs O(order^3) operations.
+    The recurrence coefficients depend on the order only, so one instance serves all
+    grids and threads.
+    \param InputVoxelIterator  iterator over the voxels of the grid
+    \param MomentT             type of the moments -- recommended to be double
+ */
+template<class InputVoxelIterator, class MomentT>
+class DirectZernikeMoments
+{
+public:
+    // ---- public typedefs ----
+    typedef MomentT             T;
+    typedef vector<T>           T1D;        // vector of scalar type
+    typedef vector<T1D>         T2D;        // 2D array of scalar type
+
+    typedef std::complex<T>     ComplexT;   // complex type
+    typedef vector<ComplexT>    ComplexT1D; // vector of complex type
+
+    using VoxelType = typename std::iterator_traits<InputVoxelIterator>::value_type;
+
+    // ---- public member functions ----
+    explicit DirectZernikeMoments(int _order)
+    {
+        Init(_order);
+    }
+
+    /**
+        Computes the recurrence coefficients of the radial and the harmonic polynomials
+        up to _order.
+     */
+    void Init(int _order)
+    {
+        static_assert(std::is_floating_point<T>::value, "MomentT must be float, double or long double");
+
+        order_ = _order;
+
+        InitHarmonics();
+        InitRadials();
+    }
+
+    /**
+        Computes the Zernike moments of the grid translated by the center of gravity and
+        scaled by _scale, one per row of the coefficient table (see ZernikeMomentRow()).
+        Voxels whose corner is farther than sqrt(_sqrRadius) from the center of gravity
+        are cut off as in ScaledGeometricalMoments. The layers along the slowest memory
+        axis are processed in chunks of fixed size on _threads threads and summed in
+        order, so the moments are the same for any number of threads.
+     */
+    void Compute(
+        InputVoxelIterator _voxels, /**< the cubic voxel grid */
+        std::size_t _dim,           /**< dimension is $_dim^3$ */
+        T _xCOG,                    /**< x-coord of the center of gravity */
+        T _yCOG,                    /**< y-coord of the center of gravity */
+        T _zCOG,                    /**< z-coord of the center of gravity */
+        T _scale,                   /**< scaling factor */
+        T _sqrRadius,               /**< squared radius of the cut off ball */
+        ComplexT1D & _moments,      /**< the Zernike moments */
+        unsigned _threads = 1,      /**< number of threads for computing */
+        VoxelLayout _layout = VoxelLayout::Canonical()  /**< axis order of the grid in memory */
+    ) const
+    {
+        const std::size_t chunkLayers = 4;
+        const std::size_t chunkCount = (_dim + chunkLayers - 1) / chunkLayers;
+
+        T cogs[3] = { _xCOG, _yCOG, _zCOG };
+
+        // distances of the voxel corners from the COG and the scaled voxel centers along the memory axes
+        T2D corners(3, T1D(_dim)), centers(3, T1D(_dim));
+
+        for (int n = 0; n < 3; ++n)
+        {
+            T cog = cogs[_layout.axes_[n]];
+
+            for (std::size_t p = 0; p < _dim; ++p)
+            {
+                corners[n][p] = static_cast<T>(p) - cog;
+                centers[n][p] = (static_cast<T>(p) + static_cast<T>(0.5) - cog) * _scale;
+            }
+        }
+
+        vector<T1D> chunks(chunkCount, T1D(2 * sumCount_, static_cast<T>(0)));
+
+        ParallelFor(chunkCount, _threads, [&](std::size_t _chunk)
+        {
+            T1D harmonics(2 * harmonicCount_), radials(radialCount_);
+            T * sums = chunks[_chunk].data();
+
+            std::size_t end = std::min(_dim, (_chunk + 1) * chunkLayers);
+
+            InputVoxelIterator iter{ _voxels };
+            iter += _chunk * chunkLayers * _dim * _dim;
+
+            // the coordinates along the memory axes, fastest first
+            std::size_t p[3];
+            T corner[3], center[3];
+
+            for (p[2] = _chunk * chunkLayers; p[2] < end; ++p[2])
+            {
+                corner[_layout.axes_[2]] = corners[2][p[2]];
+                center[_layout.axes_[2]] = centers[2][p[2]];
+
+                for (p[1] = 0; p[1] < _dim; ++p[1])
+                {
+                    corner[_layout.axes_[1]] = corners[1][p[1]];
+                    center[_layout.axes_[1]] = centers[1][p[1]];
+
+                    for (p[0] = 0; p[0] < _dim; ++p[0], ++iter)
+                    {
+                        VoxelType value = *iter;
+
+                        if (value == static_cast<VoxelType>(0))
+                        {
+                            continue;
+                        }
+
+                        corner[_layout.axes_[0]] = corners[0][p[0]];
+
+                        // the same test as ScaledGeometricalMoments::SqrDistance()
+                        if (!(corner[0] * corner[0] + corner[1] * corner[1] + corner[2] * corner[2] <= _sqrRadius))
+                        {
+                            continue;
+                        }
+
+                        center[_layout.axes_[0]] = centers[0][p[0]];
+
+                        AddVoxel(center, static_cast<T>(value), harmonics.data(), radials.data(), sums);
+                    }
+                }
+            }
+        });
+
+        T1D sums(2 * sumCount_, static_cast<T>(0));
+
+        for (const T1D & chunk : chunks)
+        {
+            for (std::size_t s = 0; s < sums.size(); ++s)
+            {
+                sums[s] += chunk[s];
+            }
+        }
+
+        // the voxel volume and the factors of the polynomials, conj(i^m) = (-i)^m
+        constexpr T three_quarters_div_pi = boost::math::constants::three_quarters<T>() * 1 / boost::math::constants::pi<T>();
+
+        T volume = _scale * _scale * _scale * three_quarters_div_pi;
+
+        _moments.assign(ZernikeMomentCount(order_), ComplexT(0, 0));
+
+        for (int l = 0; l <= order_; ++l)
+        {
+            for (int m = 0; m <= l; ++m)
+            {
+                const std::size_t offset = sumOffsets_[Harmonic(l, m)];
+
+                ComplexT phase;
+
+                switch (m % 4)
+                {
+                    case 0: phase = ComplexT(1, 0); break;
+                    case 1: phase = ComplexT(0, -1); break;
+                    case 2: phase = ComplexT(-1, 0); break;
+                    case 3: phase = ComplexT(0, 1); break;
+                }
+
+                for (int k = 0; l + 2 * k <= order_; ++k)
+                {
+                    int n = l + 2 * k;
+
+                    T factor = volume * std::sqrt(static_cast<T>(2 * n + 3) / static_cast<T>(3));
+
+                    _moments[ZernikeMomentRow(n, l, m)] = phase * factor * ComplexT(sums[2 * (offset + k)], sums[2 * (offset + k) + 1]);
+                }
+            }
+        }
+    }
+
+    int GetOrder() const
+    {
+        return order_;
+    }
+
+private:
+    // ---- private attributes -----
+    int         order_;             // maximal order of the moments
+
+    std::size_t harmonicCount_;     // number of solid harmonics [l,m], m >= 0
+    std::size_t radialCount_;       // number of radial polynomials [l,k]
+    std::size_t sumCount_;          // number of sums [l,m,k], i.e. Zernike moments
+
+    T1D         diagonals_;         // S_mm from S_(m-1)(m-1), one per m
+    T1D         harmonicsA_;        // S_lm = A z S_(l-1)m - B r^2 S_(l-2)m, one per [l,m] with l > m
+    T1D         harmonicsB_;
+
+    vector<std::size_t> radialOffsets_; // first radial polynomial of each l
+    T1D         radialsA_;          // P_k = (A r^2 + B) P_(k-1) - C P_(k-2), one per [l,k] with k > 0
+    T1D         radialsB_;
+    T1D         radialsC_;
+
+    vector<std::size_t> sumOffsets_;    // first sum of each [l,m], the sums of k follow
+
+    // ---- private functions ----
+    /// index of the solid harmonic [l,m]
+    static std::size_t Harmonic(int _l, int _m)
+    {
+        return static_cast<std::size_t>(_l) * (_l + 1) / 2 + _m;
+    }
+
+    /**
+ * The recurrences of the normalized associated Legendre functions in l and along
+ * the diagonal m = l, applied to the solid harmonics.
+ */
+    void InitHarmonics()
+    {
+        harmonicCount_ = Harmonic(order_ + 1, 0);
+
+        diagonals_.assign(order_ + 1, static_cast<T>(1));
+        harmonicsA_.assign(harmonicCount_, static_cast<T>(0));
+        harmonicsB_.assign(harmonicCount_, static_cast<T>(0));
+
+        for (int m = 1; m <= order_; ++m)
+        {
+            diagonals_[m] = std::sqrt(static_cast<T>(2 * m + 1) / static_cast<T>(2 * m));
+        }
+
+        for (int l = 1; l <= order_; ++l)
+        {
+            for (int m = 0; m < l; ++m)
+            {
+                T lm = static_cast<T>((l - m) * (l + m));
+
+                harmonicsA_[Harmonic(l, m)] = std::sqrt(static_cast<T>((2 * l - 1) * (2 * l + 1)) / lm);
+
+                if (l - m >= 2)
+                {
+                    harmonicsB_[Harmonic(l, m)] = std::sqrt(static_cast<T>((2 * l + 1) * (l + m - 1) * (l - m - 1)) / (static_cast<T>(2 * l - 3) * lm));
+                }
+            }
+        }
+    }
+
+    /**
+ * The recurrence of the Jacobi polynomials P_k^(0, l + 1/2)(t) with t = 2 r^2 - 1,
+ * and the offsets of the sums.
+ */
+    void InitRadials()
+    {
+        radialOffsets_.resize(order_ + 1);
+        radialCount_ = 0;
+
+        for (int l = 0; l <= order_; ++l)
+        {
+            radialOffsets_[l] = radialCount_;
+            radialCount_ += (order_ - l) / 2 + 1;
+        }
+
+        radialsA_.assign(radialCount_, static_cast<T>(0));
+        radialsB_.assign(radialCount_, static_cast<T>(0));
+        radialsC_.assign(radialCount_, static_cast<T>(0));
+
+        for (int l = 0; l <= order_; ++l)
+        {
+            T beta = static_cast<T>(l) + static_cast<T>(0.5);
+
+            for (int k = 1; l + 2 * k <= order_; ++k)
+            {
+                T s = static_cast<T>(2 * k) + beta;
+                T d = static_cast<T>(2 * k) * (static_cast<T>(k) + beta);
+
+                // 2k (k + b) (s - 2) P_k = (s - 1) (s (s - 2) t - b^2) P_(k-1) - 2 (k - 1) (k + b - 1) s P_(k-2)
+                T a = (s - 1) * s / d;
+                T b = -(s - 1) * beta * beta / (d * (s - 2));
+
+                std::size_t index = radialOffsets_[l] + k;
+
+                radialsA_[index] = 2 * a;
+                radialsB_[index] = b - a;
+                radialsC_[index] = 2 * (k - 1) * (static_cast<T>(k - 1) + beta) * s / (d * (s - 2));
+            }
+        }
+
+        sumOffsets_.resize(harmonicCount_);
+        sumCount_ = 0;
+
+        for (int l = 0; l <= order_; ++l)
+        {
+            for (int m = 0; m <= l; ++m)
+            {
+                sumOffsets_[Harmonic(l, m)] = sumCount_;
+                sumCount_ += (order_ - l) / 2 + 1;
+            }
+        }
+    }
+
+    /**
+        Adds the conjugated polynomials at the scaled voxel center _point times _value to
+        _sums, the real and imaginary parts of each [l,m,k] are adjacent.
+     */
+    void AddVoxel(const T _point[3], T _value, T * _harmonics, T * _radials, T * _sums) const
+    {
+        const T x = _point[0], y = _point[1], z = _point[2];
+        const T sqrR = x * x + y * y + z * z;
+
+        // solid harmonics, real and imaginary parts adjacent
+        _harmonics[0] = static_cast<T>(1);
+        _harmonics[1] = static_cast<T>(0);
+
+        for (int m = 0; m <= order_; ++m)
+        {
+            std::size_t mm = Harmonic(m, m);
+
+            if (m > 0)
+            {
+                std::size_t prev = Harmonic(m - 1, m - 1);
+
+                T re = _harmonics[2 * prev], im = _harmonics[2 * prev + 1];
+
+                _harmonics[2 * mm] = diagonals_[m] * (x * re - y * im);
+                _harmonics[2 * mm + 1] = diagonals_[m] * (x * im + y * re);
+            }
+
+            T re2 = 0, im2 = 0;
+            T re1 = _harmonics[2 * mm], im1 = _harmonics[2 * mm + 1];
+
+            for (int l = m + 1; l <= order_; ++l)
+            {
+                std::size_t lm = Harmonic(l, m);
+
+                T a = harmonicsA_[lm] * z, b = harmonicsB_[lm] * sqrR;
+                T re = a * re1 - b * re2, im = a * im1 - b * im2;
+
+                _harmonics[2 * lm] = re;
+                _harmonics[2 * lm + 1] = im;
+
+                re2 = re1;
+                im2 = im1;
+                re1 = re;
+                im1 = im;
+            }
+        }
+
+        // radial polynomials times the value of the voxel
+        for (int l = 0; l <= order_; ++l)
+        {
+            T * radials = _radials + radialOffsets_[l];
+            const T * a = radialsA_.data() + radialOffsets_[l];
+            const T * b = radialsB_.data() + radialOffsets_[l];
+            const T * c = radialsC_.data() + radialOffsets_[l];
+
+            T p2 = 0, p1 = _value;
+
+            radials[0] = p1;
+
+            for (int k = 1; l + 2 * k <= order_; ++k)
+            {
+                T p = (a[k] * sqrR + b[k]) * p1 - c[k] * p2;
+
+                radials[k] = p;
+
+                p2 = p1;
+                p1 = p;
+            }
+        }
+
+        for (int l = 0; l <= order_; ++l)
+        {
+            const T * radials = _radials + radialOffsets_[l];
+            const int kCount = (order_ - l) / 2 + 1;
+
+            for (int m = 0; m <= l; ++m)
+            {
+                std::size_t lm = Harmonic(l, m);
+
+                const T re = _harmonics[2 * lm], im = _harmonics[2 * lm + 1];
+                T * sums = _sums + 2 * sumOffsets_[lm];
+
+                for (int k = 0; k < kCount; ++k)
+                {
+                    sums[2 * k] += radials[k] * re;
+                    sums[2 * k + 1] -= radials[k] * im;
+                }
+            }
+        }
+    }
+};
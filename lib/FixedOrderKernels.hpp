@@ -0,0 +1,170 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+// Orders up to this one get a kernel with a trip count fixed at compile time, higher ones the generic loop
+#ifndef ZM_FIXED_MAX_ORDER
+#define ZM_FIXED_MAX_ORDER 20
+#endif
+
+/**
+ * Kernel of the projection onto the powers of the samples of all orders at once.
+ * Row n of _powers holds the powers of sample n, the projection of the weights w_n is
+ *
+ *     sums[c] = sum of w_n * powers[n * stride + c],   c < count.
+ *
+ * The count is padded to a multiple of four (see PaddedCount()), the rows of _powers
+ * and _sums have to hold the padded count. For every padded count up to the one of
+ * ZM_FIXED_MAX_ORDER + 1 there is an instance with the count as template argument,
+ * its sums stay in registers and the loop over c has a trip count the compiler
+ * vectorizes without a remainder. GetKernels() selects the instance at runtime,
+ * larger counts fall back to the generic loop. All instances sum in the same order
+ * as the generic loop, so the results don't depend on the selected kernel.
+ */
+namespace fixed
+{
+    namespace detail
+    {
+        template<class T, int Count>
+        void ProjectDense(const T * _weights, std::size_t _size, const T * _powers, std::size_t _stride, int, T * _sums)
+        {
+            T sums[Count] = {};
+
+            for (std::size_t n = 0; n < _size; ++n)
+            {
+                const T weight = _weights[n];
+
+                // most weights of a diff function are zero
+                if (weight == static_cast<T>(0))
+                {
+                    continue;
+                }
+
+                const T * powers = _powers + n * _stride;
+
+                for (int c = 0; c < Count; ++c)
+                {
+                    sums[c] += weight * powers[c];
+                }
+            }
+
+            for (int c = 0; c < Count; ++c)
+            {
+                _sums[c] = sums[c];
+            }
+        }
+
+        template<class T>
+        void ProjectDenseGeneric(const T * _weights, std::size_t _size, const T * _powers, std::size_t _stride, int _count, T * _sums)
+        {
+            for (int c = 0; c < _count; ++c)
+            {
+                _sums[c] = static_cast<T>(0);
+            }
+
+            for (std::size_t n = 0; n < _size; ++n)
+            {
+                const T weight = _weights[n];
+
+                if (weight == static_cast<T>(0))
+                {
+                    continue;
+                }
+
+                const T * powers = _powers + n * _stride;
+
+                for (int c = 0; c < _count; ++c)
+                {
+                    _sums[c] += weight * powers[c];
+                }
+            }
+        }
+    }
+
+    /// The count rounded up to a multiple of four
+    inline int PaddedCount(int _count)
+    {
+        return (_count + 3) & ~3;
+    }
+
+    /**
+     * The kernels of one type by padded count / 4, index 0 is unused.
+     */
+    template<class T>
+    struct Kernels
+    {
+        /// projection of all rows n < _size with the weights _weights[n]
+        typedef void (*ProjectDenseFunction)(const T * _weights, std::size_t _size, const T * _powers, std::size_t _stride, int _count, T * _sums);
+
+        static constexpr int maxQuads = (ZM_FIXED_MAX_ORDER + 4) / 4;
+
+        std::array<ProjectDenseFunction, maxQuads + 1> dense_;
+
+        /// kernel of the padded count
+        ProjectDenseFunction Dense(int _count) const
+        {
+            return _count <= 4 * maxQuads ? dense_[_count / 4] : &detail::ProjectDenseGeneric<T>;
+        }
+    };
+
+    namespace detail
+    {
+        template<class T, int... Quads>
+        Kernels<T> MakeKernels(std::integer_sequence<int, Quads...>)
+        {
+            return Kernels<T>{ { { &ProjectDenseGeneric<T>, &ProjectDense<T, 4 * (Quads + 1)>... } } };
+        }
+    }
+
+    /// The kernels of all padded counts, built once
+    template<class T>
+    const Kernels<T> & GetKernels()
+    {
+        static const Kernels<T> kernels = detail::MakeKernels<T>(std::make_integer_sequence<int, Kernels<T>::maxQuads>());
+
+        return kernels;
+    }
+}
@@ -0,0 +1,663 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// ----- local program includes -----
+#include "BitGrid.hpp"
+#include "ScaledGeometricMoments.hpp"
+
+/**
+    Moments of a binary voxel grid that is edited after the moments have been computed.
+    The grid is kept as a BitGrid in the order (z * dim + y) * dim + x together with
+    its raw moments, i.e. the moments about the grid center in units of half the edge
+    length, and the sums needed for the normalization (see VoxelSums). An edit updates
+    them in time proportional to the changed voxels.
+    The scaled moments about the center of gravity of the edited grid are derived from
+    the raw moments analytically by the binomial theorem. If the grid is cut off by a
+    ball that does not contain all occupied voxels, they are computed from the grid
+    instead (see ComputeMoments()). The first and last occupied voxel of each line
+    are kept to decide this exactly.
+    \param MomentT  type of the moments -- recommended to be double
+ */
+template<class MomentT>
+class IncrementalMoments
+{
+public:
+    // ---- public typedefs ----
+    /// the moment type
+    typedef MomentT             T;
+    /// vector scalar type
+    typedef vector<T>           T1D;
+
+    // ---- construction / init ----
+    /**
+        Computes the raw moments of a grid of the given dimension. Non-zero voxels are occupied.
+     */
+    template<class InputVoxelIterator>
+    IncrementalMoments(
+        InputVoxelIterator _voxels,     /**< the cubic voxel grid */
+        std::size_t _dim,               /**< dimension of the grid */
+        int _maxOrder                   /**< maximal order of the moments */
+    ) : grid_(_dim * _dim * _dim), dim_(_dim), maxOrder_(_maxOrder)
+    {
+        for (std::size_t index = 0; index < grid_.size(); ++index, ++_voxels)
+        {
+            if (*_voxels)
+            {
+                grid_[index] = true;
+            }
+        }
+
+        Init();
+    }
+
+    /// Contructor for bit grids, the words are copied
+    IncrementalMoments(
+        const BitGrid & _voxels,        /**< the cubic voxel grid */
+        std::size_t _dim,               /**< dimension of the grid */
+        int _maxOrder                   /**< maximal order of the moments */
+    ) : grid_(_voxels), dim_(_dim), maxOrder_(_maxOrder)
+    {
+        Init();
+    }
+
+    /**
+        Sets a single voxel, the moments change by the integrals over the voxel.
+     */
+    void SetVoxel(std::size_t _x, std::size_t _y, std::size_t _z, bool _value)
+    {
+        std::size_t index = (_z * dim_ + _y) * dim_ + _x;
+
+        if (grid_[index] == _value)
+        {
+            return;
+        }
+
+        grid_[index] = _value;
+
+        T sign = _value ? static_cast<T>(1) : static_cast<T>(-1);
+        const int nOrders = maxOrder_ + 1;
+
+        T1D line(nOrders);
+
+        for (int a = 0; a < nOrders; ++a)
+        {
+            line[a] = sign * Integral(_x, a);
+        }
+
+        AddLine(line, _y, _z);
+        UpdateSums(_x, _y, _z, _value);
+        UpdateExtent(_y, _z);
+    }
+
+    /**
+        Replaces the voxels of the box [_x0, _x0 + _xSize) x [_y0, _y0 + _ySize) x [_z0, _z0 + _zSize)
+        with _voxels given in the order of the grid, x being the fastest coordinate.
+        Only the lines with changed voxels contribute to the update.
+     */
+    template<class InputVoxelIterator>
+    void SetBox(
+        std::size_t _x0, std::size_t _y0, std::size_t _z0,
+        std::size_t _xSize, std::size_t _ySize, std::size_t _zSize,
+        InputVoxelIterator _voxels      /**< new voxels of the box */
+    )
+    {
+        const int nOrders = maxOrder_ + 1;
+
+        T1D line(nOrders);
+
+        for (std::size_t z = _z0; z < _z0 + _zSize; ++z)
+        {
+            for (std::size_t y = _y0; y < _y0 + _ySize; ++y)
+            {
+                bool changed = false;
+
+                std::fill(line.begin(), line.end(), static_cast<T>(0));
+
+                for (std::size_t x = _x0; x < _x0 + _xSize; ++x, ++_voxels)
+                {
+                    bool value = static_cast<bool>(*_voxels);
+                    std::size_t index = (z * dim_ + y) * dim_ + x;
+
+                    if (grid_[index] == value)
+                    {
+                        continue;
+                    }
+
+                    grid_[index] = value;
+                    changed = true;
+
+                    T sign = value ? static_cast<T>(1) : static_cast<T>(-1);
+
+                    for (int a = 0; a < nOrders; ++a)
+                    {
+                        line[a] += sign * Integral(x, a);
+                    }
+
+                    UpdateSums(x, y, z, value);
+                }
+
+                if (changed)
+                {
+                    AddLine(line, y, z);
+                    UpdateExtent(y, z);
+                }
+            }
+        }
+    }
+
+    /**
+        Computes the moments up to GetMaxOrder() of the grid translated by the center of
+        gravity and scaled by _scale, i.e. the same moments as ScaledGeometricalMoments.
+        If the ball of radius sqrt(_sqrRadius) does not contain all occupied voxels,
+        the voxels outside have to be cut off and the moments are computed from the grid.
+        Otherwise only the ends of the lines are tested, dim^2 instead of dim^3 voxels.
+     */
+    T1D ComputeMoments(
+        T _xCOG,                /**< x-coord of the center of gravity */
+        T _yCOG,                /**< y-coord of the center of gravity */
+        T _zCOG,                /**< z-coord of the center of gravity */
+        T _scale,               /**< scaling factor */
+        T _sqrRadius = std::numeric_limits<T>::infinity(),  /**< squared radius of the cut off ball */
+        unsigned _threads = 1   /**< number of threads if the grid has to be read */
+    ) const
+    {
+        static_assert(std::is_floating_point<T>::value, "MomentT must be float, double or long double");
+
+        if (!IsInsideBall(_xCOG, _yCOG, _zCOG, _sqrRadius))
+        {
+            int dim = static_cast<int>(dim_);
+
+            ScaledGeometricalMoments<BitGrid::const_iterator, T> gm(grid_.cbegin(), dim, dim, dim,
+                _xCOG, _yCOG, _zCOG, _scale, maxOrder_, _threads, _sqrRadius);
+
+            return gm.GetMoments();
+        }
+
+        return TranslateMoments(_xCOG, _yCOG, _zCOG, _scale);
+    }
+
+    /// Sums over the occupied voxels for the normalization
+    const VoxelSums & GetSums() const
+    {
+        return sums_;
+    }
+
+    /// The edited grid
+    const BitGrid & GetVoxels() const
+    {
+        return grid_;
+    }
+
+    std::size_t GetDim() const
+    {
+        return dim_;
+    }
+
+    int GetMaxOrder() const
+    {
+        return maxOrder_;
+    }
+
+private:
+    BitGrid     grid_;                  // the voxels in the order (z * dim + y) * dim + x
+    std::size_t dim_;                   // dimension of the grid
+    int         maxOrder_;              // maximal order of the moments
+
+    T1D         powers_;                // powers 1..maxOrder_+1 of the voxel boundaries in raw units
+    T1D         rawMoments_;            // flat tetrahedral array of the raw moments times (i+1)(j+1)(k+1)
+    VoxelSums   sums_;                  // sums for the normalization
+    vector<int> lineLower_,             // first and last occupied voxel of each line, lower > upper
+                lineUpper_;             // for empty lines
+
+    // ---- private functions ----
+    void Init()
+    {
+        static_assert(std::is_floating_point<T>::value, "MomentT must be float, double or long double");
+
+        const int nOrders = maxOrder_ + 1;
+
+        // the raw coordinate of the boundary x is (x - dim / 2) / (dim / 2), so the powers are at most one
+        T half = static_cast<T>(dim_) / static_cast<T>(2);
+
+        powers_.resize((dim_ + 1) * nOrders);
+
+        for (std::size_t x = 0; x <= dim_; ++x)
+        {
+            T sample = (static_cast<T>(x) - half) / half;
+            T power = sample;
+
+            for (int a = 0; a < nOrders; ++a)
+            {
+                powers_[x * nOrders + a] = power;
+                power *= sample;
+            }
+        }
+
+        rawMoments_.assign(GeometricalMomentCount(maxOrder_), static_cast<T>(0));
+
+        lineLower_.resize(dim_ * dim_);
+        lineUpper_.resize(dim_ * dim_);
+
+        T1D line(nOrders);
+        T1D layer(nOrders * nOrders);   // moments of a layer along x and y for (i, j)
+
+        for (std::size_t z = 0; z < dim_; ++z)
+        {
+            bool isLayer = false;
+
+            std::fill(layer.begin(), layer.end(), static_cast<T>(0));
+
+            for (std::size_t y = 0; y < dim_; ++y)
+            {
+                UpdateExtent(y, z);
+
+                if (!ComputeLine((z * dim_ + y) * dim_, y, z, line))
+                {
+                    continue;
+                }
+
+                for (int a = 0; a < nOrders; ++a)
+                {
+                    for (int b = 0; b < nOrders - a; ++b)
+                    {
+                        layer[a * nOrders + b] += line[a] * Integral(y, b);
+                    }
+                }
+
+                isLayer = true;
+            }
+
+            if (isLayer)
+            {
+                AddLayer(layer, z);
+            }
+        }
+    }
+
+    /**
+        Integrals along x of the occupied runs of a grid line, found word by word.
+        The sums are updated as well. Returns false for empty lines.
+     */
+    bool ComputeLine(std::size_t _offset, std::size_t _y, std::size_t _z, T1D & _line)
+    {
+        const int wordBits = BitGrid::wordBits;
+        const int nOrders = maxOrder_ + 1;
+        const int dim = static_cast<int>(dim_);
+
+        const BitGrid::Word * words = grid_.GetWords().data();
+        BitGrid::Word previous = 0;
+        bool isOccupied = false;
+
+        std::fill(_line.begin(), _line.end(), static_cast<T>(0));
+
+        // the integral over a run is the difference of the powers at its ends
+        auto addBoundary = [&](int _x, T _sign)
+        {
+            const T * powers = &powers_[_x * nOrders];
+
+            for (int a = 0; a < nOrders; ++a)
+            {
+                _line[a] += _sign * powers[a];
+            }
+        };
+
+        for (int x0 = 0; x0 < dim; x0 += wordBits)
+        {
+            int count = std::min(wordBits, dim - x0);
+
+            BitGrid::Word word = BitGrid::GetBits(words, _offset + x0, count);
+            BitGrid::Word changes = (word ^ ((word << 1) | previous)) & bits::LowMask(count);
+
+            previous = (word >> (count - 1)) & 1;
+
+            while (changes)
+            {
+                int bit = bits::CountTrailingZeros(changes);
+
+                addBoundary(x0 + bit, ((word >> bit) & 1) ? static_cast<T>(-1) : static_cast<T>(1));
+
+                changes &= changes - 1;
+            }
+
+            for (BitGrid::Word rest = word; rest; rest &= rest - 1)
+            {
+                UpdateSums(x0 + bits::CountTrailingZeros(rest), _y, _z, true);
+                isOccupied = true;
+            }
+        }
+
+        if (previous)
+        {
+            addBoundary(dim, static_cast<T>(1));
+        }
+
+        return isOccupied;
+    }
+
+    /// Finds the first and the last occupied voxel of a line
+    void UpdateExtent(std::size_t _y, std::size_t _z)
+    {
+        const int wordBits = BitGrid::wordBits;
+        const int dim = static_cast<int>(dim_);
+
+        const BitGrid::Word * words = grid_.GetWords().data();
+        std::size_t line = _z * dim_ + _y;
+        std::size_t offset = line * dim_;
+
+        int lower = dim, upper = -1;
+
+        for (int x0 = 0; x0 < dim; x0 += wordBits)
+        {
+            int count = std::min(wordBits, dim - x0);
+
+            BitGrid::Word word = BitGrid::GetBits(words, offset + x0, count);
+
+            if (word)
+            {
+                lower = std::min(lower, x0 + bits::CountTrailingZeros(word));
+
+                for (int bit = count - 1; bit >= 0; --bit)
+                {
+                    if ((word >> bit) & 1)
+                    {
+                        upper = x0 + bit;
+                        break;
+                    }
+                }
+            }
+        }
+
+        lineLower_[line] = lower;
+        lineUpper_[line] = upper;
+    }
+
+    /// Integral of the raw coordinate to the power _a over the voxel _x times (_a + 1)
+    T Integral(std::size_t _x, int _a) const
+    {
+        const int nOrders = maxOrder_ + 1;
+
+        return powers_[(_x + 1) * nOrders + _a] - powers_[_x * nOrders + _a];
+    }
+
+    /// Adds the integrals of a line along x times the integrals over the voxel (_y, _z)
+    void AddLine(const T1D & _line, std::size_t _y, std::size_t _z)
+    {
+        const int nOrders = maxOrder_ + 1;
+
+        T1D layer(nOrders * nOrders);
+
+        for (int a = 0; a < nOrders; ++a)
+        {
+            for (int b = 0; b < nOrders - a; ++b)
+            {
+                layer[a * nOrders + b] = _line[a] * Integral(_y, b);
+            }
+        }
+
+        AddLayer(layer, _z);
+    }
+
+    /// Adds the moments of a layer along x and y times the integrals over the layer _z
+    void AddLayer(const T1D & _layer, std::size_t _z)
+    {
+        const int nOrders = maxOrder_ + 1;
+
+        typename T1D::iterator momentIter = rawMoments_.begin();
+
+        for (int a = 0; a < nOrders; ++a)
+        {
+            for (int b = 0; b < nOrders - a; ++b)
+            {
+                T moment = _layer[a * nOrders + b];
+
+                for (int c = 0; c < nOrders - a - b; ++c)
+                {
+                    *momentIter++ += moment * Integral(_z, c);
+                }
+            }
+        }
+    }
+
+    void UpdateSums(std::uint64_t _x, std::uint64_t _y, std::uint64_t _z, bool _value)
+    {
+        std::uint64_t p[3] = { _x, _y, _z };
+
+        for (int n = 0; n < 3; ++n)
+        {
+            if (_value)
+            {
+                sums_.sum_[n] += p[n];
+                sums_.sqrSum_[n] += p[n] * p[n];
+            }
+            else
+            {
+                sums_.sum_[n] -= p[n];
+                sums_.sqrSum_[n] -= p[n] * p[n];
+            }
+        }
+
+        if (_value)
+        {
+            sums_.count_++;
+        }
+        else
+        {
+            sums_.count_--;
+        }
+    }
+
+    /**
+        Tests the end of each line farther from the center of gravity in the same way as
+        ScaledGeometricalMoments tests single voxels. The test is monotonous in the
+        distance, so all voxels of a line pass if its farther end does.
+     */
+    bool IsInsideBall(T _xCOG, T _yCOG, T _zCOG, T _sqrRadius) const
+    {
+        if (!(_sqrRadius < std::numeric_limits<T>::infinity()))
+        {
+            return true;
+        }
+
+        for (std::size_t z = 0; z < dim_; ++z)
+        {
+            T pz = static_cast<T>(z) - _zCOG;
+
+            for (std::size_t y = 0; y < dim_; ++y)
+            {
+                std::size_t line = z * dim_ + y;
+
+                if (lineLower_[line] > lineUpper_[line])
+                {
+                    continue;
+                }
+
+                T py = static_cast<T>(y) - _yCOG;
+                T lower = static_cast<T>(lineLower_[line]) - _xCOG;
+                T upper = static_cast<T>(lineUpper_[line]) - _xCOG;
+                T px = std::max(std::abs(lower), std::abs(upper));
+
+                if (!(px * px + py * py + pz * pz <= _sqrRadius))
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /**
+        The scaled coordinate t = (x - cog) * scale is h * scale * (u - d) with the raw
+        coordinate u = (x - h) / h, h = dim / 2 and d = (cog - h) / h. The moments of
+        (u - d)^i follow from the raw moments of u^a, a <= i, by the binomial theorem,
+        applied along x, y and z one after the other.
+     */
+    T1D TranslateMoments(T _xCOG, T _yCOG, T _zCOG, T _scale) const
+    {
+        const int nOrders = maxOrder_ + 1;
+
+        T half = static_cast<T>(dim_) / static_cast<T>(2);
+        T shift[3] = { (_xCOG - half) / half, (_yCOG - half) / half, (_zCOG - half) / half };
+
+        // binomial coefficients times the powers of -shift, one table per axis
+        vector<T1D> binomials(3, T1D(nOrders * nOrders, static_cast<T>(0)));
+
+        for (int n = 0; n < 3; ++n)
+        {
+            T1D & table = binomials[n];
+
+            table[0] = static_cast<T>(1);
+
+            for (int i = 1; i < nOrders; ++i)
+            {
+                for (int a = 0; a <= i; ++a)
+                {
+                    // (u - d)^i = (u - d)^(i - 1) * u - (u - d)^(i - 1) * d
+                    T value = -shift[n] * table[(i - 1) * nOrders + a];
+
+                    if (a > 0)
+                    {
+                        value += table[(i - 1) * nOrders + a - 1];
+                    }
+
+                    table[i * nOrders + a] = value;
+                }
+            }
+        }
+
+        // dense cube of the raw moments, the translation is applied in place along each axis
+        std::size_t size = static_cast<std::size_t>(nOrders) * nOrders * nOrders;
+        T1D cube(size, static_cast<T>(0));
+
+        auto at = [nOrders](int _i, int _j, int _k)
+        {
+            return (static_cast<std::size_t>(_i) * nOrders + _j) * nOrders + _k;
+        };
+
+        typename T1D::const_iterator rawIter = rawMoments_.begin();
+
+        for (int i = 0; i < nOrders; ++i)
+        {
+            for (int j = 0; j < nOrders - i; ++j)
+            {
+                for (int k = 0; k < nOrders - i - j; ++k)
+                {
+                    cube[at(i, j, k)] = *rawIter++ / static_cast<T>((1 + i) * (1 + j) * (1 + k));
+                }
+            }
+        }
+
+        T1D column(nOrders);
+
+        for (int n = 0; n < 3; ++n)
+        {
+            const T1D & table = binomials[n];
+
+            // the index along the current axis and the two others
+            for (int p = 0; p < nOrders; ++p)
+            {
+                for (int q = 0; q < nOrders - p; ++q)
+                {
+                    int length = nOrders - p - q;
+
+                    auto index = [&](int _m)
+                    {
+                        return n == 0 ? at(_m, p, q) : (n == 1 ? at(p, _m, q) : at(p, q, _m));
+                    };
+
+                    for (int i = 0; i < length; ++i)
+                    {
+                        T value{ 0 };
+
+                        for (int a = 0; a <= i; ++a)
+                        {
+                            value += table[i * nOrders + a] * cube[index(a)];
+                        }
+
+                        column[i] = value;
+                    }
+
+                    for (int i = 0; i < length; ++i)
+                    {
+                        cube[index(i)] = column[i];
+                    }
+                }
+            }
+        }
+
+        // dt = h * scale * du along each axis
+        T factor = half * _scale;
+        T1D factors(nOrders + 3);
+
+        factors[0] = static_cast<T>(1);
+
+        for (int i = 1; i < nOrders + 3; ++i)
+        {
+            factors[i] = factors[i - 1] * factor;
+        }
+
+        T1D moments(rawMoments_.size());
+        typename T1D::iterator momentIter = moments.begin();
+
+        for (int i = 0; i < nOrders; ++i)
+        {
+            for (int j = 0; j < nOrders - i; ++j)
+            {
+                for (int k = 0; k < nOrders - i - j; ++k)
+                {
+                    *momentIter++ = cube[at(i, j, k)] * factors[i + j + k + 3];
+                }
+            }
+        }
+
+        return moments;
+    }
+};
@@ -0,0 +1,289 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// ----- local program includes -----
+#include "ParallelFor.hpp"
+#include "ScaledGeometricMoments.hpp"
+
+/**
+ * Triangle of a closed mesh, the vertices are counter-clockwise seen from outside
+ */
+struct MeshTriangle
+{
+    double vertices_[3][3];     // x, y, z of the three vertices
+};
+
+/**
+    Class for computing the geometrical moments of the volume enclosed by a closed
+    triangle mesh. By the divergence theorem the volume is the sum of the signed
+    tetrahedra spanned by the origin and the triangles. The moments of a tetrahedron
+    with the vertices 0, a, b, c are
+
+        det(a, b, c) * i! j! k! / (i + j + k + 3)! * S_ijk,
+
+    where S_ijk is the coefficient of t^(i, j, k) in the product of the three series
+    1 / (1 - t.a), 1 / (1 - t.b), 1 / (1 - t.c). S is built by one recursion per
+    vertex over the moment array, so a triangle costs O(order^3).
+    The mesh is translated by the center of gravity and scaled before, so the moments
+    are those of ScaledGeometricalMoments without voxelization and without the cut off
+    by a ball.
+    \param MomentT  type of the moments -- recommended to be double
+ */
+template<class MomentT>
+class MeshMoments
+{
+public:
+    // ---- public typedefs ----
+    /// the moment type
+    typedef MomentT             T;
+    /// vector scalar type
+    typedef vector<T>           T1D;
+
+    // ---- construction / init ----
+    /// Contructor
+    MeshMoments(
+        const vector<MeshTriangle> & _triangles     /**< triangles of the closed mesh */
+    ) : triangles_(&_triangles), maxOrder_(0)
+    {
+    }
+
+    /**
+        Computes the moments up to _maxOrder of the volume translated by the center of
+        gravity and scaled by _scale. A mesh oriented inwards has a negative volume, its
+        moments are negated.
+        The triangles are summed in chunks of fixed size on _threads threads, so the
+        moments are the same for any number of threads.
+     */
+    void Compute(
+        T _xCOG,                /**< x-coord of the center of gravity */
+        T _yCOG,                /**< y-coord of the center of gravity */
+        T _zCOG,                /**< z-coord of the center of gravity */
+        T _scale,               /**< scaling factor */
+        int _maxOrder,          /**< maximal order to compute moments for */
+        unsigned _threads = 1   /**< number of threads for computing */
+    )
+    {
+        static_assert(std::is_floating_point<T>::value, "MomentT must be float, double or long double");
+
+        const std::size_t chunkSize = 1024;
+
+        maxOrder_ = _maxOrder;
+
+        InitTables();
+
+        const std::size_t count = triangles_->size();
+        const std::size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+        const std::size_t momentCount = GeometricalMomentCount(maxOrder_);
+
+        T cog[3] = { _xCOG, _yCOG, _zCOG };
+
+        vector<T1D> chunks(chunkCount, T1D(momentCount, static_cast<T>(0)));
+
+        ParallelFor(chunkCount, _threads, [&](std::size_t _chunk)
+        {
+            T1D products(momentCount);
+            T vertices[3][3];
+
+            std::size_t end = std::min(count, (_chunk + 1) * chunkSize);
+
+            for (std::size_t t = _chunk * chunkSize; t < end; ++t)
+            {
+                const MeshTriangle & triangle = (*triangles_)[t];
+
+                for (int v = 0; v < 3; ++v)
+                {
+                    for (int n = 0; n < 3; ++n)
+                    {
+                        vertices[v][n] = (static_cast<T>(triangle.vertices_[v][n]) - cog[n]) * _scale;
+                    }
+                }
+
+                AddTetrahedron(vertices, products, chunks[_chunk]);
+            }
+        });
+
+        moments_.assign(momentCount, static_cast<T>(0));
+
+        for (const T1D & chunk : chunks)
+        {
+            for (std::size_t m = 0; m < momentCount; ++m)
+            {
+                moments_[m] += chunk[m];
+            }
+        }
+
+        if (!moments_.empty() && moments_[0] < static_cast<T>(0))
+        {
+            for (T & moment : moments_)
+            {
+                moment = -moment;
+            }
+        }
+    }
+
+    /// Access function
+    T GetMoment(
+        int _i,                 /**< order along x */
+        int _j,                 /**< order along y */
+        int _k                  /**< order along z */
+    ) const
+    {
+        return moments_[GeometricalMomentIndex(_i, _j, _k, maxOrder_)];
+    }
+
+    /// All moments in the flat tetrahedral order, see GeometricalMomentIndex()
+    const T1D & GetMoments() const
+    {
+        return moments_;
+    }
+
+    int GetMaxOrder() const
+    {
+        return maxOrder_;
+    }
+
+private:
+    const vector<MeshTriangle> * triangles_;    // triangles of the mesh
+    int             maxOrder_;                  // maximal order of the moments
+
+    vector<int>     previous_[3];               // index of the moment with the order along x, y, z lower by one, -1 if none
+    T1D             factors_;                   // i! j! k! / (i + j + k + 3)!
+    T1D             moments_;                   // flat tetrahedral array containing the moments
+
+    // ---- private functions ----
+    void InitTables()
+    {
+        const int momentCount = GeometricalMomentCount(maxOrder_);
+
+        for (int n = 0; n < 3; ++n)
+        {
+            previous_[n].assign(momentCount, -1);
+        }
+
+        factors_.resize(momentCount);
+
+        // factorials up to (maxOrder_ + 3)!
+        T1D factorials(maxOrder_ + 4);
+
+        factorials[0] = static_cast<T>(1);
+
+        for (int n = 1; n < maxOrder_ + 4; ++n)
+        {
+            factorials[n] = factorials[n - 1] * static_cast<T>(n);
+        }
+
+        int index = 0;
+
+        for (int i = 0; i <= maxOrder_; ++i)
+        {
+            for (int j = 0; j <= maxOrder_ - i; ++j)
+            {
+                for (int k = 0; k <= maxOrder_ - i - j; ++k, ++index)
+                {
+                    previous_[0][index] = i > 0 ? GeometricalMomentIndex(i - 1, j, k, maxOrder_) : -1;
+                    previous_[1][index] = j > 0 ? GeometricalMomentIndex(i, j - 1, k, maxOrder_) : -1;
+                    previous_[2][index] = k > 0 ? GeometricalMomentIndex(i, j, k - 1, maxOrder_) : -1;
+
+                    factors_[index] = factorials[i] * factorials[j] * factorials[k] / factorials[i + j + k + 3];
+                }
+            }
+        }
+    }
+
+    /**
+        Adds the moments of the tetrahedron spanned by the origin and the vertices,
+        _products is a buffer for S.
+     */
+    void AddTetrahedron(const T _vertices[3][3], T1D & _products, T1D & _moments) const
+    {
+        const T * a = _vertices[0];
+        const T * b = _vertices[1];
+        const T * c = _vertices[2];
+
+        T det = a[0] * (b[1] * c[2] - b[2] * c[1])
+            - a[1] * (b[0] * c[2] - b[2] * c[0])
+            + a[2] * (b[0] * c[1] - b[1] * c[0]);
+
+        if (det == static_cast<T>(0))
+        {
+            return;
+        }
+
+        const std::size_t momentCount = _products.size();
+
+        std::fill(_products.begin(), _products.end(), static_cast<T>(0));
+        _products[0] = static_cast<T>(1);
+
+        // multiplying by 1 / (1 - t.v) is the recursion S_m += sum_n v_n S_(m - e_n) in increasing order
+        const int * previousX = previous_[0].data();
+        const int * previousY = previous_[1].data();
+        const int * previousZ = previous_[2].data();
+
+        for (int v = 0; v < 3; ++v)
+        {
+            const T * vertex = _vertices[v];
+
+            for (std::size_t m = 1; m < momentCount; ++m)
+            {
+                T sum = _products[m];
+
+                if (previousX[m] >= 0) sum += vertex[0] * _products[previousX[m]];
+                if (previousY[m] >= 0) sum += vertex[1] * _products[previousY[m]];
+                if (previousZ[m] >= 0) sum += vertex[2] * _products[previousZ[m]];
+
+                _products[m] = sum;
+            }
+        }
+
+        for (std::size_t m = 0; m < momentCount; ++m)
+        {
+            _moments[m] += det * factors_[m] * _products[m];
+        }
+    }
+};
@@ -0,0 +1,200 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+
+#pragma once
+
+// ---- std includes ---
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// ---- local program includes ----
+#include "ZernikeCoefficients.hpp"
+
+/**
+ * The complex Zernike moments of one object together with the normalization they
+ * refer to, i.e. everything needed to rebuild a ZernikeMoments state, compute other
+ * invariants or reconstruct the object without going back to the voxels (see
+ * ZernikeDescriptor::GetMomentsRecord() and the constructor taking a record).
+ * Write() and Read() convert it from and to a compact binary blob: a header of 48 bytes
+ * followed by the center of gravity, the scale and the moments of m >= 0 in the order of
+ * ZernikeMomentRow() as pairs of real and imaginary parts, all in the native byte order.
+ */
+template<class T>
+struct MomentsRecord
+{
+    typedef std::complex<T>             ComplexT;
+    typedef std::vector<ComplexT>       ComplexT1D;
+
+    int             order_ = 0;         // maximal order of the moments (N in paper)
+    std::uint64_t   dim_ = 0;           // edge of the voxel grid, 1 for meshes
+    T               xCOG_ = 0,          // center of gravity
+                    yCOG_ = 0,
+                    zCOG_ = 0,
+                    scale_ = 0;         // scaling factor mapping the object into the unit ball
+    ComplexT1D      moments_;           // one moment per row, ZernikeMomentCount(order_) in total
+
+    /**
+ * Appends the blob of the record to _blob
+ */
+    void Write(std::vector<unsigned char> & _blob) const
+    {
+        if (moments_.size() != static_cast<size_t>(ZernikeMomentCount(order_)))
+        {
+            throw std::invalid_argument("MomentsRecord<T>::Write (): Zernike moments are not of the given order.");
+        }
+
+        Header header{};
+
+        std::memcpy(header.magic, Header::Magic(), sizeof(header.magic));
+        header.version = Header::currentVersion;
+        header.valueSize = sizeof(T);
+        header.valueDigits = std::numeric_limits<T>::digits;
+        header.order = order_;
+        header.dim = dim_;
+        header.momentCount = moments_.size();
+
+        const T normalization[4] = { xCOG_, yCOG_, zCOG_, scale_ };
+
+        size_t offset = _blob.size();
+        _blob.resize(offset + sizeof(header) + sizeof(normalization) + moments_.size() * sizeof(ComplexT));
+
+        unsigned char * out = _blob.data() + offset;
+
+        std::memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+
+        std::memcpy(out, normalization, sizeof(normalization));
+        out += sizeof(normalization);
+
+        // std::complex<T> is laid out as an array of its real and imaginary part
+        std::memcpy(out, moments_.data(), moments_.size() * sizeof(ComplexT));
+    }
+
+    /**
+ * Reads a record written by Write() for the same T. Throws std::invalid_argument if the
+ * blob is truncated, damaged or holds another moment type.
+ */
+    static MomentsRecord Read(const unsigned char * _blob, size_t _size)
+    {
+        Header header;
+
+        if (_size < sizeof(header))
+        {
+            throw std::invalid_argument("MomentsRecord<T>::Read (): the blob is shorter than its header.");
+        }
+
+        std::memcpy(&header, _blob, sizeof(header));
+
+        if (std::memcmp(header.magic, Header::Magic(), sizeof(header.magic)) != 0 ||
+            header.version != Header::currentVersion)
+        {
+            throw std::invalid_argument("MomentsRecord<T>::Read (): the blob does not hold Zernike moments.");
+        }
+
+        if (header.valueSize != sizeof(T) || header.valueDigits != std::numeric_limits<T>::digits)
+        {
+            throw std::invalid_argument("MomentsRecord<T>::Read (): the moments are of another type.");
+        }
+
+        T normalization[4];
+
+        if (header.order < 0 ||
+            header.momentCount != static_cast<std::uint64_t>(ZernikeMomentCount(header.order)) ||
+            _size != sizeof(header) + sizeof(normalization) + header.momentCount * sizeof(ComplexT))
+        {
+            throw std::invalid_argument("MomentsRecord<T>::Read (): the size of the blob does not match its order.");
+        }
+
+        const unsigned char * in = _blob + sizeof(header);
+
+        std::memcpy(normalization, in, sizeof(normalization));
+        in += sizeof(normalization);
+
+        MomentsRecord record;
+
+        record.order_ = header.order;
+        record.dim_ = header.dim;
+        record.xCOG_ = normalization[0];
+        record.yCOG_ = normalization[1];
+        record.zCOG_ = normalization[2];
+        record.scale_ = normalization[3];
+        record.moments_.resize(header.momentCount);
+
+        std::memcpy(record.moments_.data(), in, header.momentCount * sizeof(ComplexT));
+
+        return record;
+    }
+
+    static MomentsRecord Read(const std::vector<unsigned char> & _blob)
+    {
+        return Read(_blob.data(), _blob.size());
+    }
+
+private:
+    /**
+ * Header of the blob, it is followed by the normalization and the moments
+ */
+    struct Header
+    {
+        static constexpr std::uint32_t currentVersion = 1;
+
+        static const char * Magic()
+        {
+            return "ZMMOMTS";
+        }
+
+        char            magic[8];
+        std::uint32_t   version;
+        std::uint32_t   valueSize;          // sizeof(T)
+        std::uint32_t   valueDigits;        // mantissa digits of T
+        std::int32_t    order;
+        std::uint64_t   dim;
+        std::uint64_t   momentCount;
+        std::uint32_t   reserved[2];
+    };
+
+    static_assert(sizeof(Header) == 48, "Unexpected size of the header of the moments");
+};
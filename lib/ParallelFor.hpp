@@ -0,0 +1,124 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Calls _function(i) for i in [0, _count) on _threads threads. The indices are
+ * handed out one by one, so the load is balanced for tasks of different cost.
+ * The calling thread is one of the workers. The first exception thrown by
+ * _function stops the remaining work and is rethrown.
+ */
+template<class Function>
+void ParallelFor(size_t _count, unsigned _threads, Function _function)
+{
+    std::atomic<size_t> next{ 0 };
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto worker = [&]()
+    {
+        try
+        {
+            for (size_t i = next++; i < _count; i = next++)
+            {
+                _function(i);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            error = std::current_exception();
+            next = _count;
+        }
+    };
+
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 1; t < std::min<size_t>(_threads, _count); ++t)
+    {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+ * Calls _function(begin, end) for consecutive ranges covering [0, _count) on
+ * _threads threads. Each index belongs to exactly one range, so a function
+ * writing only the results of its own indices gives the same results for any
+ * number of threads. With one thread the whole range is processed in place.
+ */
+template<class Function>
+void ParallelForRanges(size_t _count, unsigned _threads, Function _function)
+{
+    if (_threads <= 1 || _count <= 1)
+    {
+        _function(size_t{ 0 }, _count);
+        return;
+    }
+
+    // a few ranges per thread balance the load without much overhead
+    const size_t rangeCount = std::min<size_t>(_count, 4 * static_cast<size_t>(_threads));
+
+    ParallelFor(rangeCount, _threads, [&](size_t _range)
+    {
+        _function(_range * _count / rangeCount, (_range + 1) * _count / rangeCount);
+    });
+}
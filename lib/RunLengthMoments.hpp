@@ -0,0 +1,333 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// ----- local program includes -----
+#include "ScaledGeometricMoments.hpp"
+
+/**
+ * Run of voxels with the same value as stored in binvox files
+ */
+struct VoxelRun
+{
+    unsigned char value_;   // voxel value, non-zero means occupied
+    unsigned char count_;   // number of voxels in the run
+};
+
+/**
+    Class for computing the scaled, pre-integrated geometrical moments (see
+    ScaledGeometricalMoments) of a binary voxel grid given by the run-length
+    encoding of binvox. The runs follow the binvox order: x is the slowest
+    coordinate, then z, and y is the fastest one.
+    Each run is split at the ends of the grid lines and integrated along y in
+    closed form, so the cost is proportional to the number of runs and not
+    to the number of voxels.
+    \param MomentT  type of the moments -- recommended to be double
+ */
+template<class MomentT>
+class RunLengthMoments
+{
+public:
+    // ---- public typedefs ----
+    /// the moment type
+    typedef MomentT             T;
+    /// vector scalar type
+    typedef vector<T>           T1D;
+
+    // ---- construction / init ----
+    /// Contructor
+    RunLengthMoments(
+        const vector<VoxelRun> & _runs,     /**< runs of the cubic voxel grid */
+        int _dim                            /**< dimension of the grid */
+    ) : runs_(&_runs), dim_(_dim), maxOrder_(0)
+    {
+    }
+
+    /**
+        Computes the sums over all occupied voxels needed for the normalization
+     */
+    VoxelSums ComputeSums() const
+    {
+        VoxelSums sums;
+
+        ForEachSegment([&sums](std::uint64_t _x, std::uint64_t _z, std::uint64_t _yBegin, std::uint64_t _yEnd)
+        {
+            std::uint64_t count = _yEnd - _yBegin;
+
+            sums.count_ += count;
+            sums.sum_[0] += _x * count;
+            sums.sum_[1] += (_yBegin + _yEnd - 1) * count / 2;
+            sums.sum_[2] += _z * count;
+            sums.sqrSum_[0] += _x * _x * count;
+            sums.sqrSum_[1] += SumOfSquares(_yEnd) - SumOfSquares(_yBegin);
+            sums.sqrSum_[2] += _z * _z * count;
+        });
+
+        return sums;
+    }
+
+    /**
+        Computes the moments up to _maxOrder of the grid translated by the center of gravity
+        and scaled by _scale. Voxels whose centers are farther from the center of gravity
+        than sqrt(_sqrRadius) are skipped, i.e. the grid may be cut off by a ball.
+     */
+    void Compute(
+        T _xCOG,                /**< x-coord of the center of gravity */
+        T _yCOG,                /**< y-coord of the center of gravity */
+        T _zCOG,                /**< z-coord of the center of gravity */
+        T _scale,               /**< scaling factor */
+        int _maxOrder,          /**< maximal order to compute moments for */
+        T _sqrRadius = std::numeric_limits<T>::infinity()  /**< squared radius of the cut off ball */
+    )
+    {
+        static_assert(std::is_floating_point<T>::value, "MomentT must be float, double or long double");
+
+        maxOrder_ = _maxOrder;
+
+        const int nOrders = maxOrder_ + 1;
+
+        ComputeSamplePowers(_xCOG, _scale, dim_, maxOrder_, xPowers_);
+        ComputeSamplePowers(_yCOG, _scale, dim_, maxOrder_, yPowers_);
+        ComputeSamplePowers(_zCOG, _scale, dim_, maxOrder_, zPowers_);
+
+        moments_.assign(GeometricalMomentCount(maxOrder_), static_cast<T>(0));
+
+        T1D line(nOrders);              // line moments along y for j
+        T1D slab(nOrders * nOrders);    // slab moments along y and z for (j, k)
+
+        long long lineX = -1, lineZ = -1;
+        bool isLine = false, isSlab = false;
+
+        auto flushLine = [&]()
+        {
+            const T * lower = &zPowers_[lineZ * nOrders];
+            const T * upper = lower + nOrders;
+
+            for (int j = 0; j < nOrders; ++j)
+            {
+                for (int k = 0; k < nOrders - j; ++k)
+                {
+                    slab[j * nOrders + k] += line[j] * (upper[k] - lower[k]);
+                }
+            }
+
+            std::fill(line.begin(), line.end(), static_cast<T>(0));
+            isLine = false;
+            isSlab = true;
+        };
+
+        auto flushSlab = [&]()
+        {
+            const T * lower = &xPowers_[lineX * nOrders];
+            const T * upper = lower + nOrders;
+
+            typename T1D::iterator momentIter = moments_.begin();
+
+            for (int i = 0; i < nOrders; ++i)
+            {
+                T diff = upper[i] - lower[i];
+
+                for (int j = 0; j < nOrders - i; ++j)
+                {
+                    for (int k = 0; k < nOrders - i - j; ++k)
+                    {
+                        *momentIter++ += diff * slab[j * nOrders + k];
+                    }
+                }
+            }
+
+            std::fill(slab.begin(), slab.end(), static_cast<T>(0));
+            isSlab = false;
+        };
+
+        const bool cutOff = _sqrRadius < std::numeric_limits<T>::infinity();
+
+        ForEachSegment([&](long long _x, long long _z, long long _yBegin, long long _yEnd)
+        {
+            if (_x != lineX || _z != lineZ)
+            {
+                if (isLine)
+                {
+                    flushLine();
+                }
+
+                if (_x != lineX && isSlab)
+                {
+                    flushSlab();
+                }
+
+                lineX = _x;
+                lineZ = _z;
+            }
+
+            if (cutOff)
+            {
+                T px = static_cast<T>(_x) - _xCOG;
+                T pz = static_cast<T>(_z) - _zCOG;
+
+                // the same test as for single voxels
+                auto inside = [&](long long _y)
+                {
+                    T py = static_cast<T>(_y) - _yCOG;
+                    return px * px + py * py + pz * pz <= _sqrRadius;
+                };
+
+                ClipToChord(_yBegin, _yEnd, _yCOG, _sqrRadius - px * px - pz * pz, inside);
+
+                if (_yBegin == _yEnd)
+                {
+                    return;
+                }
+            }
+
+            // the integral of y^j over the voxels is the difference at the ends of the run
+            const T * lower = &yPowers_[_yBegin * nOrders];
+            const T * upper = &yPowers_[_yEnd * nOrders];
+
+            for (int j = 0; j < nOrders; ++j)
+            {
+                line[j] += upper[j] - lower[j];
+            }
+
+            isLine = true;
+        });
+
+        if (isLine)
+        {
+            flushLine();
+        }
+
+        if (isSlab)
+        {
+            flushSlab();
+        }
+
+        typename T1D::iterator momentIter = moments_.begin();
+
+        for (int i = 0; i < nOrders; ++i)
+        {
+            for (int j = 0; j < nOrders - i; ++j)
+            {
+                for (int k = 0; k < nOrders - i - j; ++k)
+                {
+                    *momentIter++ /= static_cast<T>((1 + i) * (1 + j) * (1 + k));
+                }
+            }
+        }
+    }
+
+    /// Access function
+    T GetMoment(
+        int _i,                 /**< order along x */
+        int _j,                 /**< order along y */
+        int _k                  /**< order along z */
+    ) const
+    {
+        return moments_[GeometricalMomentIndex(_i, _j, _k, maxOrder_)];
+    }
+
+    /// All moments in the flat tetrahedral order, see GeometricalMomentIndex()
+    const T1D & GetMoments() const
+    {
+        return moments_;
+    }
+
+    int GetMaxOrder() const
+    {
+        return maxOrder_;
+    }
+
+private:
+    const vector<VoxelRun> * runs_;     // runs of the voxel grid
+    int         dim_,                   // dimension of the grid
+                maxOrder_;              // maximal order of the moments
+
+    T1D         xPowers_,               // powers 1..maxOrder_+1 of the samples in x, y, z
+                yPowers_,
+                zPowers_;
+    T1D         moments_;               // flat tetrahedral array containing the moments
+
+    // ---- private functions ----
+    /**
+        Calls _function(x, z, yBegin, yEnd) for all parts of the occupied runs within a grid line
+     */
+    template<class Function>
+    void ForEachSegment(Function _function) const
+    {
+        const std::uint64_t dim = dim_;
+
+        std::uint64_t index = 0;
+
+        for (const VoxelRun & run : *runs_)
+        {
+            std::uint64_t end = index + run.count_;
+
+            if (run.value_)
+            {
+                while (index < end)
+                {
+                    std::uint64_t line = index / dim;
+                    std::uint64_t y = index % dim;
+                    std::uint64_t yEnd = std::min(dim, y + end - index);
+
+                    _function(line / dim, line % dim, y, yEnd);
+
+                    index += yEnd - y;
+                }
+            }
+
+            index = end;
+        }
+    }
+
+    /// Sum of y^2 for y in [0, _end)
+    static std::uint64_t SumOfSquares(std::uint64_t _end)
+    {
+        return _end == 0 ? 0 : (_end - 1) * _end * (2 * _end - 1) / 6;
+    }
+};
\ No newline at end of file
@@ -41,10 +41,272 @@ for more information, see the paper:
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <vector>
 
+// ----- local program includes -----
+#include "BitGrid.hpp"
+#include "FixedOrderKernels.hpp"
+#include "ParallelFor.hpp"
+#include "SimdKernels.hpp"
+
 using std::vector;
 
+/**
+    Number of geometrical moments of order (i,j,k) with i+j+k <= _maxOrder.
+ */
+inline int GeometricalMomentCount(int _maxOrder)
+{
+    return (_maxOrder + 1) * (_maxOrder + 2) * (_maxOrder + 3) / 6;
+}
+
+/**
+    Index of the moment of order (i,j,k) in the flat tetrahedral array of all
+    moments with i+j+k <= _maxOrder. The moments are ordered by i, then j, then k.
+ */
+inline int GeometricalMomentIndex(int _i, int _j, int _k, int _maxOrder)
+{
+    // all moments with the first index less than _i
+    int rest = _maxOrder - _i;
+    int index = GeometricalMomentCount(_maxOrder) - GeometricalMomentCount(rest);
+
+    // all moments with the first index equal to _i and the second less than _j
+    index += (rest + 1) * (rest + 2) / 2 - (rest - _j + 1) * (rest - _j + 2) / 2;
+
+    return index + _k;
+}
+
+/**
+    Clips the voxels [_begin, _end) of a grid line to the chord of a ball. _center
+    is the position of the ball center along the line and _sqrHalfChord the squared
+    half length of the chord. Both only serve as an estimate, the ends are fixed by
+    the exact test _inside(index) so that the clipped voxels are the same as tested
+    voxel by voxel. On return [_begin, _end) are the voxels inside the ball.
+ */
+template<class T, class InsideFunction>
+void ClipToChord(long long & _begin, long long & _end, T _center, T _sqrHalfChord, InsideFunction _inside)
+{
+    using std::ceil;
+    using std::floor;
+    using std::sqrt;
+
+    // the line clearly misses the ball
+    if (_begin >= _end || _sqrHalfChord < static_cast<T>(-1))
+    {
+        _end = _begin;
+        return;
+    }
+
+    T halfChord = sqrt(std::max(_sqrHalfChord, static_cast<T>(0)));
+
+    long long first = std::max(_begin, static_cast<long long>(ceil(_center - halfChord)) - 1);
+    long long last = std::min(_end - 1, static_cast<long long>(floor(_center + halfChord)) + 1);
+
+    // the estimate is off by rounding only, so the voxels next to its ends decide
+    while (first <= last && !_inside(first))
+    {
+        ++first;
+    }
+
+    while (last >= first && !_inside(last))
+    {
+        --last;
+    }
+
+    if (first > last)
+    {
+        _end = _begin;
+        return;
+    }
+
+    while (first > _begin && _inside(first - 1))
+    {
+        --first;
+    }
+
+    while (last < _end - 1 && _inside(last + 1))
+    {
+        ++last;
+    }
+
+    _begin = first;
+    _end = last + 1;
+}
+
+/**
+    Powers 1.._maxOrder+1 of the samples at the voxel boundaries 0.._dim translated by
+    _cog and scaled by _scale as in ScaledGeometricalMoments, one row per sample.
+    The integral of x^i over the voxels [_begin, _end) is the difference of the rows
+    _end and _begin divided by i + 1.
+ */
+template<class T>
+void ComputeSamplePowers(T _cog, T _scale, int _dim, int _maxOrder, std::vector<T> & _powers)
+{
+    const int nOrders = _maxOrder + 1;
+
+    _powers.resize(static_cast<std::size_t>(_dim + 1) * nOrders);
+
+    double min = (-static_cast<double>(_cog)) * static_cast<double>(_scale);
+
+    for (int j = 0; j <= _dim; ++j)
+    {
+        T sample = static_cast<T>(min + j * static_cast<double>(_scale));
+        T power = sample;
+
+        for (int i = 0; i < nOrders; ++i)
+        {
+            _powers[static_cast<std::size_t>(j) * nOrders + i] = power;
+            power *= sample;
+        }
+    }
+}
+
+/**
+ * Memory layout of a dense voxel grid given by the order of its axes (0 = x,
+ * 1 = y, 2 = z) from the fastest to the slowest one. The strides follow from
+ * the order: voxels along axes_[0] are adjacent, lines along axes_[0] follow
+ * along axes_[1] and layers along axes_[2].
+ */
+struct VoxelLayout
+{
+    int axes_[3];
+
+    /// index (z * dim + y) * dim + x
+    static VoxelLayout Canonical()
+    {
+        return VoxelLayout{ { 0, 1, 2 } };
+    }
+
+    /// index (x * dim + z) * dim + y as stored in binvox files
+    static VoxelLayout Binvox()
+    {
+        return VoxelLayout{ { 1, 2, 0 } };
+    }
+
+    bool IsCanonical() const
+    {
+        return axes_[0] == 0 && axes_[1] == 1 && axes_[2] == 2;
+    }
+};
+
+/**
+ * Sums over the centers of the occupied voxels of a grid in voxel units.
+ * They give the center of gravity and the radius variance exactly.
+ */
+struct VoxelSums
+{
+    std::uint64_t count_ = 0;                   // number of occupied voxels
+    std::uint64_t sum_[3] = { 0, 0, 0 };        // sums of the x, y, z coordinates
+    std::uint64_t sqrSum_[3] = { 0, 0, 0 };     // sums of the squared coordinates
+};
+
+/**
+ * Sums collected along the axes in the memory order of _layout assigned to x, y, z
+ */
+inline VoxelSums ToGridAxes(const VoxelSums & _sums, const VoxelLayout & _layout)
+{
+    VoxelSums sums;
+
+    sums.count_ = _sums.count_;
+
+    for (int n = 0; n < 3; ++n)
+    {
+        sums.sum_[_layout.axes_[n]] = _sums.sum_[n];
+        sums.sqrSum_[_layout.axes_[n]] = _sums.sqrSum_[n];
+    }
+
+    return sums;
+}
+
+/**
+ * Sums over the occupied voxels of a cubic grid along the axes in memory order,
+ * i.e. sum_[0] runs along the lines of the grid (see ToGridAxes()).
+ * The sums of the coordinate and its square over a word come from the popcounts
+ * of the word masked by the bits of the voxel index, the sums along the other
+ * axes from the popcount of the line.
+ */
+inline VoxelSums ComputeVoxelSums(BitGrid::const_iterator _voxels, std::size_t _dim)
+{
+    typedef BitGrid::Word Word;
+
+    // bit k of the index of a voxel within a word
+    static const Word indexBits[6] =
+    {
+        0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL,
+        0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL
+    };
+
+    VoxelSums sums;
+
+    std::size_t line = 0;
+
+    for (std::uint64_t w = 0; w < _dim; ++w)
+    {
+        for (std::uint64_t v = 0; v < _dim; ++v, line += _dim)
+        {
+            std::uint64_t lineCount = 0;
+
+            for (std::uint64_t x0 = 0; x0 < _dim; x0 += BitGrid::wordBits)
+            {
+                Word word = _voxels.GetBits(line + x0, static_cast<int>(std::min<std::uint64_t>(BitGrid::wordBits, _dim - x0)));
+
+                if (word == 0)
+                {
+                    continue;
+                }
+
+                std::uint64_t count = bits::PopCount(word);
+                std::uint64_t sum = 0, sqrSum = 0;
+
+                // sum of b and b^2 over the set bits b, b = sum of 2^k over its bits k
+                for (int k = 0; k < 6; ++k)
+                {
+                    Word masked = word & indexBits[k];
+
+                    sum += static_cast<std::uint64_t>(bits::PopCount(masked)) << k;
+                    sqrSum += static_cast<std::uint64_t>(bits::PopCount(masked)) << (2 * k);
+
+                    for (int l = k + 1; l < 6; ++l)
+                    {
+                        sqrSum += static_cast<std::uint64_t>(bits::PopCount(masked & indexBits[l])) << (k + l + 1);
+                    }
+                }
+
+                lineCount += count;
+                sums.sum_[0] += x0 * count + sum;
+                sums.sqrSum_[0] += x0 * x0 * count + 2 * x0 * sum + sqrSum;
+            }
+
+            sums.count_ += lineCount;
+            sums.sum_[1] += v * lineCount;
+            sums.sqrSum_[1] += v * v * lineCount;
+            sums.sum_[2] += w * lineCount;
+            sums.sqrSum_[2] += w * w * lineCount;
+        }
+    }
+
+    return sums;
+}
+
+/**
+    Resizes a working buffer that is reused by later computations. The capacity
+    only grows, each growth is counted in _allocations.
+ */
+template<class Vector>
+void FitBuffer(Vector & _buffer, std::size_t _size, std::size_t & _allocations)
+{
+    if (_size > _buffer.capacity())
+    {
+        _buffer.reserve(_size);
+        ++_allocations;
+    }
+
+    _buffer.resize(_size);
+}
+
 /**
     Class for computing the scaled, pre-integrated geometrical moments.
     These tricks are needed to make the computation numerically stable.
@@ -85,16 +347,35 @@ public:
         double _yCOG,           /**< y-coord of the center of gravity */
         double _zCOG,           /**< z-coord of the center of gravity */
         double _scale,          /**< scaling factor */
-        int _maxOrder = 1       /**< maximal order to compute moments for */
+        int _maxOrder = 1,      /**< maximal order to compute moments for */
+        unsigned _threads = 1,  /**< number of threads for computing */
+        T _sqrRadius = std::numeric_limits<T>::infinity(),  /**< squared radius of the cut off ball */
+        VoxelLayout _layout = VoxelLayout::Canonical(),     /**< axis order of the grid in memory */
+        std::size_t _memoryLimit = 0    /**< bytes of the working buffers, 0 for no limit */
     )
     {
-        Init(_voxels, _xDim, _yDim, _zDim, _xCOG, _yCOG, _zCOG, _scale, _maxOrder);
+        Init(_voxels, _xDim, _yDim, _zDim, _xCOG, _yCOG, _zCOG, _scale, _maxOrder, _threads, _sqrRadius, _layout, _memoryLimit);
     }
 
     /// Default constructor
     ScaledGeometricalMoments() = default;
 
-    /// The init function used by the contructors
+    /**
+        The init function used by the contructors. The grid lines are distributed
+        among _threads threads, each line is processed by one thread only, so the
+        moments are the same for any number of threads.
+        Voxels whose distance from the center of gravity is greater than sqrt(_sqrRadius)
+        (in voxel units) count as zero. Each line is clipped to its chord of the ball,
+        so the voxels are neither modified nor tested one by one.
+        The grid is traversed in the memory order given by _layout, the moments
+        are permuted back to x, y, z at the end.
+        The grid is processed in slabs of layers along the slowest memory axis whose
+        working buffers fit into _memoryLimit bytes (see AddSlab()). Without a limit
+        the whole grid is one slab.
+        The working buffers are kept for the next Init() on the same object and only
+        grow, so computing grids no larger than the ones before allocates nothing
+        with one thread (see GetAllocationCount()).
+     */
     void Init(
         InputVoxelIterator _voxels,  /**< input voxel grid */
         int _xDim,              /**< x-dimension of the input voxel grid */
@@ -104,30 +385,127 @@ public:
         double _yCOG,           /**< y-coord of the center of gravity */
         double _zCOG,           /**< z-coord of the center of gravity */
         double _scale,          /**< scaling factor */
-        int _maxOrder = 1       /**< maximal order to compute moments for */
+        int _maxOrder = 1,      /**< maximal order to compute moments for */
+        unsigned _threads = 1,  /**< number of threads for computing */
+        T _sqrRadius = std::numeric_limits<T>::infinity(),  /**< squared radius of the cut off ball */
+        VoxelLayout _layout = VoxelLayout::Canonical(),     /**< axis order of the grid in memory */
+        std::size_t _memoryLimit = 0    /**< bytes of the working buffers, 0 for no limit */
+    )
+    {
+        BeginSlabs(_xDim, _yDim, _zDim, _xCOG, _yCOG, _zCOG, _scale, _maxOrder, _threads, _sqrRadius, _layout);
+
+        std::size_t slabDim = GetSlabDim(_memoryLimit);
+        std::size_t layerSize = static_cast<std::size_t>(xDim_) * yDim_;
+
+        for (std::size_t z = 0; z < static_cast<std::size_t>(zDim_); z += slabDim)
+        {
+            InputVoxelIterator slab{ _voxels };
+            slab += z * layerSize;
+
+            AddSlab(slab, z, std::min(z + slabDim, static_cast<std::size_t>(zDim_)));
+        }
+
+        EndSlabs();
+    }
+
+    /**
+        Starts the moments of a grid that is passed slab by slab to AddSlab(), e.g.
+        while it is read from a file that does not fit into memory. The parameters
+        are the same as for Init().
+     */
+    void BeginSlabs(
+        int _xDim,              /**< x-dimension of the input voxel grid */
+        int _yDim,              /**< y-dimension of the input voxel grid */
+        int _zDim,              /**< z-dimension of the input voxel grid */
+        double _xCOG,           /**< x-coord of the center of gravity */
+        double _yCOG,           /**< y-coord of the center of gravity */
+        double _zCOG,           /**< z-coord of the center of gravity */
+        double _scale,          /**< scaling factor */
+        int _maxOrder = 1,      /**< maximal order to compute moments for */
+        unsigned _threads = 1,  /**< number of threads for computing */
+        T _sqrRadius = std::numeric_limits<T>::infinity(),  /**< squared radius of the cut off ball */
+        VoxelLayout _layout = VoxelLayout::Canonical()      /**< axis order of the grid in memory */
     )
     {
-        xDim_ = _xDim;
-        yDim_ = _yDim;
-        zDim_ = _zDim;
+        // from here on x, y, z are the memory axes of the grid, fastest first
+        int dims[3] = { _xDim, _yDim, _zDim };
+        double cogs[3] = { _xCOG, _yCOG, _zCOG };
+
+        layout_ = _layout;
+
+        xDim_ = dims[layout_.axes_[0]];
+        yDim_ = dims[layout_.axes_[1]];
+        zDim_ = dims[layout_.axes_[2]];
 
         maxOrder_ = _maxOrder;
+        threads_ = std::max(1u, _threads);
 
-        moments_.resize(maxOrder_ + 1);
+        xCOG_ = static_cast<T>(cogs[layout_.axes_[0]]);
+        yCOG_ = static_cast<T>(cogs[layout_.axes_[1]]);
+        zCOG_ = static_cast<T>(cogs[layout_.axes_[2]]);
+        sqrRadius_ = _sqrRadius;
 
-        for (int i = 0; i <= maxOrder_; ++i)
+        FitBuffer(moments_, GeometricalMomentCount(maxOrder_), allocations_);
+        std::fill(moments_.begin(), moments_.end(), static_cast<T>(0));
+
+        ComputeSamples(cogs[layout_.axes_[0]], cogs[layout_.axes_[1]], cogs[layout_.axes_[2]], _scale);
+    }
+
+    /**
+        Adds the moments of the layers [_zBegin, _zEnd) along the slowest memory axis,
+        _slab points to the first voxel of layer _zBegin. The slabs may come in any
+        order, together they have to cover the grid once. Only the buffers of the
+        slab are allocated, about GetSlabBytes() per layer.
+     */
+    void AddSlab(
+        InputVoxelIterator _slab,   /**< voxels of the slab in memory order */
+        std::size_t _zBegin,        /**< first layer of the slab */
+        std::size_t _zEnd           /**< layer after the slab */
+    )
+    {
+        if (_zBegin < _zEnd)
         {
-            moments_[i].resize(maxOrder_ - i + 1);
+            Compute(_slab, _zBegin, _zEnd);
+        }
+    }
 
-            for (int j = 0; j <= maxOrder_ - i; ++j)
-            {
-                moments_[i][j].resize(maxOrder_ - i - j + 1);
-            }
+    /**
+        Finishes the moments after the last slab.
+     */
+    void EndSlabs()
+    {
+        if (!layout_.IsCanonical())
+        {
+            PermuteMoments();
         }
+    }
+
+    /**
+        Bytes of the working buffers per layer of a slab.
+     */
+    std::size_t GetSlabBytes() const
+    {
+        std::size_t yDim = yDim_;
+
+        // layers of all x orders, diff layer, arrays and diff array per layer
+        std::size_t orders = maxOrder_ + 1;
+
+        return sizeof(T) * (orders * yDim + (yDim + 1) + orders + 1);
+    }
+
+    /**
+        Number of layers per slab whose working buffers fit into _memoryLimit bytes, at least one.
+     */
+    std::size_t GetSlabDim(std::size_t _memoryLimit) const
+    {
+        std::size_t zDim = zDim_;
 
-        ComputeSamples(_xCOG, _yCOG, _zCOG, _scale);
+        if (_memoryLimit == 0)
+        {
+            return zDim;
+        }
 
-        Compute(_voxels);
+        return std::max<std::size_t>(1, std::min(zDim, _memoryLimit / GetSlabBytes()));
     }
 
     /// Access function
@@ -135,9 +513,26 @@ public:
         int _i,                 /**< order along x */
         int _j,                 /**< order along y */
         int _k                  /**< order along z */
-    )
+    ) const
+    {
+        return moments_[GeometricalMomentIndex(_i, _j, _k, maxOrder_)];
+    }
+
+    /// All moments in the flat tetrahedral order, see GeometricalMomentIndex()
+    const T1D & GetMoments() const
     {
-        return moments_[_i][_j][_k];
+        return moments_;
+    }
+
+    int GetMaxOrder() const
+    {
+        return maxOrder_;
+    }
+
+    /// Number of times the working buffers grew since construction
+    std::size_t GetAllocationCount() const
+    {
+        return allocations_;
     }
 
 private:
@@ -145,93 +540,258 @@ private:
         yDim_,
         zDim_,
         maxOrder_;          // maximal order of the moments
+    unsigned    threads_;   // number of threads for computing
+    VoxelLayout layout_;    // axis order of the grid in memory
+
+    T           xCOG_,      // center of gravity and squared radius of the cut off ball
+                yCOG_,
+                zCOG_,
+                sqrRadius_;
 
     T2D         samples_;   // samples of the scaled and translated grid in x, y, z
-    T3D         moments_;   // array containing the cumulative moments
+    T1D         xPowers_;   // powers 1 to maxOrder_ + 1 of each x-sample, one row per sample
+    T1D         yPowers_;   // the same for the y-samples
+    T1D         moments_;   // flat tetrahedral array containing the cumulative moments
+
+    /// Buffers of the lines of one range of a slab
+    struct LineBuffers
+    {
+        vector<int> index_;     // non-zero values of the diff function of an x-line
+        T1D         value_;
+        T1D         moments_;   // projections of a line onto all orders
+    };
+
+    // working buffers, see Init()
+    T1D         layers_;        // x-projections of the lines of a slab, one block per i
+    T1D         arrays_;        // y-projections of a slab for the current i, one block per j
+    T1D         diffLayer_;     // diff functions of the layer lines
+    T1D         diffArray_;     // diff function of an array
+    T1D         permuted_;      // moments along x, y, z, see PermuteMoments()
+    LineBuffers lineBuffers_;   // the line buffers with one thread
+    std::size_t allocations_ = 0;   // growths of the working buffers
+
+    // fewer y-orders than this are projected in one vectorized pass per order
+    static constexpr int minFusedCount = 12;
 
     // ---- private functions ----
-    void Compute(InputVoxelIterator voxels)
+    /**
+        Adds the moments of the layers [_zBegin, _zEnd). The contributions of the layers
+        are independent, the diff function along z only runs over the slab and is
+        multiplied with the samples of its layers. All sizes are 64 bit.
+        The x-lines are projected onto all orders at once: the non-zero values of
+        the diff function of a line are collected while reading it and multiplied
+        with the rows of the x-sample powers, so the diff function of the grid is
+        never stored and the voxels are read once instead of once per order.
+        The diff functions of the projected lines along y are multiplied with the rows
+        of the y-sample powers in the same way once there are minFusedCount orders or
+        more, fewer orders are cheaper as in-place passes over the samples. Up to
+        ZM_FIXED_MAX_ORDER this kernel has a fixed trip count (see FixedOrderKernels.hpp).
+     */
+    void Compute(InputVoxelIterator voxels, std::size_t _zBegin, std::size_t _zEnd)
     {
         static_assert(std::is_floating_point<T>::value, "MomentT must be float, double or long double");
-        int arrayDim = zDim_;
-        int layerDim = yDim_ * zDim_;
+        std::size_t xDim = xDim_, yDim = yDim_;
 
-        int diffArrayDim = zDim_ + 1;
-        int diffLayerDim = (yDim_ + 1) * zDim_;
-        int diffGridDim = (xDim_ + 1) * layerDim;
+        std::size_t arrayDim = _zEnd - _zBegin;
+        std::size_t layerDim = yDim * arrayDim;
 
-        T1D diffGrid(diffGridDim);
-        T1D diffLayer(diffLayerDim);
-        T1D diffArray(diffArrayDim);
+        std::size_t diffArrayDim = arrayDim + 1;
+        std::size_t diffLayerDim = (yDim + 1) * arrayDim;
 
-        T1D layer(layerDim);
-        T1D array(arrayDim);
-        T   moment;
+        const std::size_t orders = maxOrder_ + 1;
+        const std::size_t lineOrders = fixed::PaddedCount(maxOrder_ + 1);
 
-        typename T1D::iterator diffIter = diffGrid.begin();
+        FitBuffer(diffLayer_, diffLayerDim, allocations_);
+        FitBuffer(diffArray_, diffArrayDim, allocations_);
 
-        InputVoxelIterator iter{ voxels };
+        FitBuffer(layers_, orders * layerDim, allocations_);    // x-projections for all i
+        FitBuffer(arrays_, orders * arrayDim, allocations_);    // arrays for all j of the current i
 
-        // generate the diff version of the voxel grid in x direction
-        for (int x = 0; x < layerDim; ++x)
+        if (threads_ <= 1)
         {
-            ComputeDiffFunction(iter, diffIter, xDim_);
-
-            iter += xDim_;
-            diffIter += xDim_ + 1;
+            FitBuffer(lineBuffers_.index_, xDim + 1, allocations_);
+            FitBuffer(lineBuffers_.value_, xDim + 1, allocations_);
+            FitBuffer(lineBuffers_.moments_, lineOrders, allocations_);
         }
 
-        for (int i = 0; i <= maxOrder_; ++i)
+        T   moment;
+
+        typename T1D::iterator momentIter = moments_.begin();
+
+        // project the x-lines, each line is read once for all orders
+        ParallelForRanges(layerDim, threads_, [&](size_t _begin, size_t _end)
         {
-            diffIter = diffGrid.begin();
-            for (int p = 0; p < layerDim; ++p)
-            {
-                // multiply the diff function with the sample values
-                T1DIter sampleIter(samples_[0].begin());
-                layer[p] = Multiply(diffIter, sampleIter, xDim_ + 1);
+            InputVoxelIterator iter{ voxels };
+            iter += _begin * xDim;
 
-                diffIter += xDim_ + 1;
+            // non-zero values of the diff function of the current line and their projections,
+            // several threads have buffers of their own
+            LineBuffers rangeBuffers;
+            LineBuffers & buffers = threads_ <= 1 ? lineBuffers_ : rangeBuffers;
+
+            if (threads_ > 1)
+            {
+                buffers.moments_.resize(lineOrders);
             }
 
-            auto layer_iter = layer.begin();
-            diffIter = diffLayer.begin();
-            for (int y = 0; y < arrayDim; ++y)
+            vector<int> & index = buffers.index_;
+            T1D & value = buffers.value_;
+            T1D & lineMoments = buffers.moments_;
+
+            for (size_t p = _begin; p < _end; ++p)
             {
-                ComputeDiffFunction(layer_iter, diffIter, yDim_);
+                long long begin = 0, end = xDim_;
+
+                if (sqrRadius_ < std::numeric_limits<T>::infinity())
+                {
+                    T py = static_cast<T>(p % yDim_) - yCOG_;
+                    T pz = static_cast<T>(_zBegin + p / yDim_) - zCOG_;
+
+                    auto inside = [&](long long _x)
+                    {
+                        T px = static_cast<T>(_x) - xCOG_;
+                        return SqrDistance(px, py, pz) <= sqrRadius_;
+                    };
+
+                    ClipToChord(begin, end, xCOG_, sqrRadius_ - py * py - pz * pz, inside);
+                }
+
+                ComputeVoxelDiffFunction(iter, xDim_, static_cast<int>(begin), static_cast<int>(end), index, value, IsBitGridIterator<InputVoxelIterator>());
+
+                ProjectLine(index, value, lineMoments);
+
+                for (int i = 0; i <= maxOrder_; ++i)
+                {
+                    layers_[i * layerDim + p] = lineMoments[i];
+                }
 
-                layer_iter += yDim_;
-                diffIter += yDim_ + 1;
+                iter += xDim;
             }
+        });
 
-            for (int j = 0; j < maxOrder_ + 1 - i; ++j)
+        for (int i = 0; i <= maxOrder_; ++i)
+        {
+            // the arrays depend on the layer lines with the same index only
+            ParallelForRanges(arrayDim, threads_, [&](size_t _begin, size_t _end)
             {
-                diffIter = diffLayer.begin();
-                for (int p = 0; p < arrayDim; ++p)
+                auto layer_iter = layers_.begin() + i * layerDim + _begin * yDim;
+                typename T1D::iterator diffIter = diffLayer_.begin() + _begin * (yDim + 1);
+
+                for (size_t y = _begin; y < _end; ++y)
+                {
+                    ComputeDiffFunction(layer_iter, diffIter, yDim_);
+
+                    layer_iter += yDim_;
+                    diffIter += yDim_ + 1;
+                }
+
+                const int count = maxOrder_ + 1 - i;
+
+                if (count < minFusedCount)
+                {
+                    for (int j = 0; j < count; ++j)
+                    {
+                        diffIter = diffLayer_.begin() + _begin * (yDim + 1);
+
+                        for (size_t p = _begin; p < _end; ++p)
+                        {
+                            T1DIter sampleIter(samples_[1].begin());
+                            arrays_[j * arrayDim + p] = Multiply(diffIter, sampleIter, yDim_ + 1);
+
+                            diffIter += yDim_ + 1;
+                        }
+                    }
+
+                    return;
+                }
+
+                // the diff functions of the lines are projected onto the y-sample powers of all j at once
+                const int paddedCount = fixed::PaddedCount(count);
+                auto project = fixed::GetKernels<T>().Dense(paddedCount);
+
+                T1D rangeMoments;
+                T1D & lineMoments = threads_ <= 1 ? lineBuffers_.moments_ : rangeMoments;
+
+                if (threads_ > 1)
                 {
-                    T1DIter sampleIter(samples_[1].begin());
-                    array[p] = Multiply(diffIter, sampleIter, yDim_ + 1);
+                    lineMoments.resize(paddedCount);
+                }
+
+                diffIter = diffLayer_.begin() + _begin * (yDim + 1);
+
+                for (size_t p = _begin; p < _end; ++p)
+                {
+                    project(&*diffIter, yDim + 1, yPowers_.data(), lineOrders, paddedCount, lineMoments.data());
+
+                    for (int j = 0; j < count; ++j)
+                    {
+                        arrays_[j * arrayDim + p] = lineMoments[j];
+                    }
 
                     diffIter += yDim_ + 1;
                 }
+            });
 
-                auto mom_iter = array.begin();
-                diffIter = diffArray.begin();
-                ComputeDiffFunction(mom_iter, diffIter, zDim_);
+            for (int j = 0; j < maxOrder_ + 1 - i; ++j)
+            {
+                auto mom_iter = arrays_.begin() + j * arrayDim;
+                typename T1D::iterator diffIter = diffArray_.begin();
+                ComputeDiffFunction(mom_iter, diffIter, static_cast<int>(arrayDim));
 
                 for (int k = 0; k < maxOrder_ + 1 - i - j; ++k)
                 {
-                    T1DIter sampleIter(samples_[2].begin());
+                    T1DIter sampleIter(samples_[2].begin() + _zBegin);
 
-                    moment = Multiply(diffIter, sampleIter, zDim_ + 1);
-                    moments_[i][j][k] = moment / ((1 + i) * (1 + j) * (1 + k));
+                    moment = Multiply(diffIter, sampleIter, static_cast<int>(diffArrayDim));
+                    *momentIter++ += moment / ((1 + i) * (1 + j) * (1 + k));
                 }
             }
         }
     }
 
+    /**
+        Squared distance of the offsets along the memory axes, summed in the order
+        x, y, z of the grid, so that the cut off is the same for any layout.
+     */
+    T SqrDistance(T _px, T _py, T _pz) const
+    {
+        T p[3];
+        p[layout_.axes_[0]] = _px;
+        p[layout_.axes_[1]] = _py;
+        p[layout_.axes_[2]] = _pz;
+
+        return p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+    }
+
+    /**
+        Reorders the moments computed along the memory axes to the orders along x, y, z.
+     */
+    void PermuteMoments()
+    {
+        T1D & moments = permuted_;
+        FitBuffer(moments, moments_.size(), allocations_);
+
+        int index = 0;
+
+        for (int i = 0; i <= maxOrder_; ++i)
+        {
+            for (int j = 0; j <= maxOrder_ - i; ++j)
+            {
+                for (int k = 0; k <= maxOrder_ - i - j; ++k)
+                {
+                    int e[3] = { i, j, k };
+
+                    moments[index++] = moments_[GeometricalMomentIndex(e[layout_.axes_[0]], e[layout_.axes_[1]], e[layout_.axes_[2]], maxOrder_)];
+                }
+            }
+        }
+
+        moments_.swap(moments);
+    }
+
     void ComputeSamples(double _xCOG, double _yCOG, double _zCOG, double _scale)
     {
-        samples_.resize(3);    // 3 dimensions
+        FitBuffer(samples_, 3, allocations_);    // 3 dimensions
 
         int dim[3];
         dim[0] = xDim_;
@@ -245,44 +805,160 @@ private:
 
         for (int i = 0; i < 3; ++i)
         {
-            samples_[i].resize(dim[i] + 1);
+            FitBuffer(samples_[i], dim[i] + 1, allocations_);
             for (int j = 0; j <= dim[i]; ++j)
             {
                 samples_[i][j] = min[i] + j * _scale;
             }
         }
+
+        // the projections of the x- and y-lines run along the rows
+        ComputePowers(samples_[0], xPowers_);
+        ComputePowers(samples_[1], yPowers_);
     }
 
-    template<typename T_ = InputVoxelIterator>
-    void ComputeDiffFunction(InputVoxelIterator _iter, T1DIter _diffIter, int _dim, std::enable_if_t<!std::is_same<T_, T1DIter>::value> * = nullptr)
+    /**
+        Powers 1 to maxOrder_ + 1 of the samples, one row per sample. The rows are padded
+        to the count of the projection kernels.
+     */
+    void ComputePowers(const T1D & _samples, T1D & _powers)
     {
-        _diffIter[0] = -_iter[0];
-        for (int i = 1; i < _dim; ++i)
+        std::size_t orders = maxOrder_ + 1;
+        std::size_t stride = fixed::PaddedCount(maxOrder_ + 1);
+
+        FitBuffer(_powers, _samples.size() * stride, allocations_);
+        std::fill(_powers.begin(), _powers.end(), static_cast<T>(0));
+
+        for (std::size_t j = 0; j < _samples.size(); ++j)
         {
-            _diffIter[i] = static_cast<MomentT>(_iter[i - 1]) - static_cast<MomentT>(_iter[i]);
+            T power = _samples[j];
+
+            for (std::size_t i = 0; i < orders; ++i)
+            {
+                _powers[j * stride + i] = power;
+                power *= _samples[j];
+            }
         }
-        _diffIter[_dim] = _iter[_dim - 1];
     }
 
-    void ComputeDiffFunction(T1DIter _iter, T1DIter _diffIter, int _dim)
+    /**
+        Projections of a line with the given non-zero values of its diff function
+        onto the x-sample powers of all orders.
+     */
+    void ProjectLine(const vector<int> & _index, const T1D & _value, T1D & _lineMoments) const
     {
-        _diffIter[0] = -_iter[0];
-        for (int i = 1; i < _dim; ++i)
+        int orders = maxOrder_ + 1;
+        int stride = fixed::PaddedCount(orders);
+
+        std::fill(_lineMoments.begin(), _lineMoments.end(), static_cast<T>(0));
+
+        for (std::size_t n = 0; n < _index.size(); ++n)
         {
-            _diffIter[i] = _iter[i - 1] - _iter[i];
+            const T * powers = xPowers_.data() + static_cast<std::size_t>(_index[n]) * stride;
+            T value = _value[n];
+
+            for (int i = 0; i < orders; ++i)
+            {
+                _lineMoments[i] += value * powers[i];
+            }
         }
-        _diffIter[_dim] = _iter[_dim - 1];
     }
 
-    T Multiply(T1DIter _diffIter, T1DIter _sampleIter, int _dim)
+    /**
+        Non-zero values of the diff function of a line of voxels in increasing order of
+        their _index, the voxels outside [_begin, _end) count as zero.
+     */
+    void ComputeVoxelDiffFunction(InputVoxelIterator _iter, int /*_dim*/, int _begin, int _end, vector<int> & _index, T1D & _value, std::false_type)
     {
-        T sum(0);
-        for (int i = 0; i < _dim; ++i)
+        _index.clear();
+        _value.clear();
+
+        // _diff[x] = voxel[x - 1] - voxel[x]
+        T previous{ 0 };
+
+        for (int x = _begin; x < _end; ++x)
         {
-            _diffIter[i] *= _sampleIter[i];
-            sum += _diffIter[i];
+            T voxel = static_cast<T>(_iter[x]);
+
+            if (voxel != previous)
+            {
+                _index.push_back(x);
+                _value.push_back(previous - voxel);
+                previous = voxel;
+            }
         }
 
-        return sum;
+        if (previous != static_cast<T>(0))
+        {
+            _index.push_back(_end);
+            _value.push_back(previous);
+        }
+    }
+
+    /**
+        The diff function of a line of a bit grid is non-zero only where the voxels change.
+        The changes are found word by word, the words outside [_begin, _end) are not read.
+     */
+    template<class BitGridIterator>
+    void ComputeVoxelDiffFunction(BitGridIterator _iter, int _dim, int _begin, int _end, vector<int> & _index, T1D & _value, std::true_type)
+    {
+        _index.clear();
+        _value.clear();
+
+        const int wordBits = BitGrid::wordBits;
+
+        BitGrid::Word previous = 0;     // the voxel before the current word
+
+        for (int x0 = 0; x0 < _dim; x0 += wordBits)
+        {
+            int count = std::min(wordBits, _dim - x0);
+
+            if (x0 + count <= _begin || x0 >= _end)
+            {
+                // the voxels outside are zero, only the end of a run before has to be recorded
+                if (previous)
+                {
+                    _index.push_back(x0);
+                    _value.push_back(static_cast<T>(1));
+                    previous = 0;
+                }
+
+                continue;
+            }
+
+            BitGrid::Word word = _iter.GetBits(x0, count)
+                & bits::LowMask(std::min(_end - x0, count)) & ~bits::LowMask(std::max(_begin - x0, 0));
+            BitGrid::Word changes = (word ^ ((word << 1) | previous)) & bits::LowMask(count);
+
+            previous = (word >> (count - 1)) & 1;
+
+            while (changes)
+            {
+                int bit = bits::CountTrailingZeros(changes);
+
+                // _diff[x] = voxel[x - 1] - voxel[x]
+                _index.push_back(x0 + bit);
+                _value.push_back(((word >> bit) & 1) ? static_cast<T>(-1) : static_cast<T>(1));
+
+                changes &= changes - 1;
+            }
+        }
+
+        if (previous)
+        {
+            _index.push_back(_dim);
+            _value.push_back(static_cast<T>(1));
+        }
+    }
+
+    // the vector kernels are selected at runtime, see SimdKernels.hpp
+    void ComputeDiffFunction(T1DIter _iter, T1DIter _diffIter, int _dim)
+    {
+        simd::DiffFunction(&*_iter, &*_diffIter, _dim);
+    }
+
+    T Multiply(T1DIter _diffIter, T1DIter _sampleIter, int _dim)
+    {
+        return simd::MultiplySum(&*_diffIter, &*_sampleIter, _dim);
     }
 };
\ No newline at end of file
@@ -0,0 +1,531 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+#pragma once
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__i386__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZM_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang compile the kernels for their instruction set only, MSVC accepts the intrinsics anywhere
+#if defined(ZM_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define ZM_SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define ZM_SIMD_TARGET(isa)
+#endif
+
+/**
+ * Vector kernels of the inner loops of ScaledGeometricalMoments for float and
+ * double. The instruction set is detected once at runtime, other types and
+ * other processors use the portable scalar loops.
+ *
+ * The differences and the products are computed element by element, so they
+ * are bitwise identical to the scalar loops (the kernels never fuse multiply
+ * and add). Only the sum in MultiplySum() is reordered into one partial sum
+ * per vector lane. Both orders are within the usual summation bound, so the
+ * vector sum of n terms x_i differs from the scalar one by at most
+ * 2(n-1) ulp of sum |x_i|.
+ */
+namespace simd
+{
+    /// Instruction sets in increasing order
+    enum class Isa
+    {
+        scalar,
+        sse2,
+        avx2,
+        avx512
+    };
+
+    /// The best instruction set supported by both the processor and the operating system
+    inline Isa DetectIsa()
+    {
+#if defined(ZM_SIMD_X86) && defined(_MSC_VER)
+        int info[4];
+
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        bool sse2 = (info[3] & (1 << 26)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+
+        // the registers must be saved by the operating system
+        unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+        bool ymm = (xcr0 & 0x6) == 0x6;
+        bool zmm = (xcr0 & 0xe6) == 0xe6;
+
+        bool avx2 = false, avx512 = false;
+
+        if (maxLeaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+            avx512 = (info[1] & (1 << 16)) != 0;
+        }
+
+        if (avx && avx512 && zmm)
+        {
+            return Isa::avx512;
+        }
+
+        if (avx && avx2 && ymm)
+        {
+            return Isa::avx2;
+        }
+
+        return sse2 ? Isa::sse2 : Isa::scalar;
+#elif defined(ZM_SIMD_X86)
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return Isa::avx512;
+        }
+
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return Isa::avx2;
+        }
+
+        return __builtin_cpu_supports("sse2") ? Isa::sse2 : Isa::scalar;
+#else
+        return Isa::scalar;
+#endif
+    }
+
+    namespace detail
+    {
+        inline Isa & ActiveIsa()
+        {
+            static Isa isa = DetectIsa();
+            return isa;
+        }
+    }
+
+    /// The instruction set used by the kernels
+    inline Isa GetIsa()
+    {
+        return detail::ActiveIsa();
+    }
+
+    /**
+     * Restricts the kernels to _isa, e.g. to compare them with the scalar loops.
+     * Instruction sets not supported by the processor are never used.
+     */
+    inline void SetIsa(Isa _isa)
+    {
+        Isa detected = DetectIsa();
+
+        detail::ActiveIsa() = _isa < detected ? _isa : detected;
+    }
+
+    /// _diff[0] = -_values[0], _diff[i] = _values[i - 1] - _values[i], _diff[_dim] = _values[_dim - 1]
+    template<class T>
+    void ScalarDiffFunction(const T * _values, T * _diff, int _dim)
+    {
+        _diff[0] = -_values[0];
+        for (int i = 1; i < _dim; ++i)
+        {
+            _diff[i] = _values[i - 1] - _values[i];
+        }
+        _diff[_dim] = _values[_dim - 1];
+    }
+
+    /// Multiplies _values by _samples in place and returns the sum of the products
+    template<class T>
+    T ScalarMultiplySum(T * _values, const T * _samples, int _count)
+    {
+        T sum(0);
+        for (int i = 0; i < _count; ++i)
+        {
+            _values[i] *= _samples[i];
+            sum += _values[i];
+        }
+
+        return sum;
+    }
+
+#ifdef ZM_SIMD_X86
+    namespace detail
+    {
+        // ---- SSE2 ----
+        ZM_SIMD_TARGET("sse2") inline void DiffFunctionSse2(const double * _values, double * _diff, int _dim)
+        {
+            _diff[0] = -_values[0];
+
+            int i = 1;
+            for (; i + 2 <= _dim; i += 2)
+            {
+                _mm_storeu_pd(_diff + i, _mm_sub_pd(_mm_loadu_pd(_values + i - 1), _mm_loadu_pd(_values + i)));
+            }
+            for (; i < _dim; ++i)
+            {
+                _diff[i] = _values[i - 1] - _values[i];
+            }
+
+            _diff[_dim] = _values[_dim - 1];
+        }
+
+        ZM_SIMD_TARGET("sse2") inline void DiffFunctionSse2(const float * _values, float * _diff, int _dim)
+        {
+            _diff[0] = -_values[0];
+
+            int i = 1;
+            for (; i + 4 <= _dim; i += 4)
+            {
+                _mm_storeu_ps(_diff + i, _mm_sub_ps(_mm_loadu_ps(_values + i - 1), _mm_loadu_ps(_values + i)));
+            }
+            for (; i < _dim; ++i)
+            {
+                _diff[i] = _values[i - 1] - _values[i];
+            }
+
+            _diff[_dim] = _values[_dim - 1];
+        }
+
+        ZM_SIMD_TARGET("sse2") inline double MultiplySumSse2(double * _values, const double * _samples, int _count)
+        {
+            __m128d sum = _mm_setzero_pd();
+
+            int i = 0;
+            for (; i + 2 <= _count; i += 2)
+            {
+                __m128d product = _mm_mul_pd(_mm_loadu_pd(_values + i), _mm_loadu_pd(_samples + i));
+                _mm_storeu_pd(_values + i, product);
+                sum = _mm_add_pd(sum, product);
+            }
+
+            double lanes[2];
+            _mm_storeu_pd(lanes, sum);
+
+            double result = lanes[0] + lanes[1];
+            for (; i < _count; ++i)
+            {
+                _values[i] *= _samples[i];
+                result += _values[i];
+            }
+
+            return result;
+        }
+
+        ZM_SIMD_TARGET("sse2") inline float MultiplySumSse2(float * _values, const float * _samples, int _count)
+        {
+            __m128 sum = _mm_setzero_ps();
+
+            int i = 0;
+            for (; i + 4 <= _count; i += 4)
+            {
+                __m128 product = _mm_mul_ps(_mm_loadu_ps(_values + i), _mm_loadu_ps(_samples + i));
+                _mm_storeu_ps(_values + i, product);
+                sum = _mm_add_ps(sum, product);
+            }
+
+            float lanes[4];
+            _mm_storeu_ps(lanes, sum);
+
+            float result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+            for (; i < _count; ++i)
+            {
+                _values[i] *= _samples[i];
+                result += _values[i];
+            }
+
+            return result;
+        }
+
+        // ---- AVX2 ----
+        ZM_SIMD_TARGET("avx2") inline void DiffFunctionAvx2(const double * _values, double * _diff, int _dim)
+        {
+            _diff[0] = -_values[0];
+
+            int i = 1;
+            for (; i + 4 <= _dim; i += 4)
+            {
+                _mm256_storeu_pd(_diff + i, _mm256_sub_pd(_mm256_loadu_pd(_values + i - 1), _mm256_loadu_pd(_values + i)));
+            }
+            for (; i < _dim; ++i)
+            {
+                _diff[i] = _values[i - 1] - _values[i];
+            }
+
+            _diff[_dim] = _values[_dim - 1];
+        }
+
+        ZM_SIMD_TARGET("avx2") inline void DiffFunctionAvx2(const float * _values, float * _diff, int _dim)
+        {
+            _diff[0] = -_values[0];
+
+            int i = 1;
+            for (; i + 8 <= _dim; i += 8)
+            {
+                _mm256_storeu_ps(_diff + i, _mm256_sub_ps(_mm256_loadu_ps(_values + i - 1), _mm256_loadu_ps(_values + i)));
+            }
+            for (; i < _dim; ++i)
+            {
+                _diff[i] = _values[i - 1] - _values[i];
+            }
+
+            _diff[_dim] = _values[_dim - 1];
+        }
+
+        ZM_SIMD_TARGET("avx2") inline double MultiplySumAvx2(double * _values, const double * _samples, int _count)
+        {
+            __m256d sum = _mm256_setzero_pd();
+
+            int i = 0;
+            for (; i + 4 <= _count; i += 4)
+            {
+                __m256d product = _mm256_mul_pd(_mm256_loadu_pd(_values + i), _mm256_loadu_pd(_samples + i));
+                _mm256_storeu_pd(_values + i, product);
+                sum = _mm256_add_pd(sum, product);
+            }
+
+            double lanes[4];
+            _mm256_storeu_pd(lanes, sum);
+
+            double result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+            for (; i < _count; ++i)
+            {
+                _values[i] *= _samples[i];
+                result += _values[i];
+            }
+
+            return result;
+        }
+
+        ZM_SIMD_TARGET("avx2") inline float MultiplySumAvx2(float * _values, const float * _samples, int _count)
+        {
+            __m256 sum = _mm256_setzero_ps();
+
+            int i = 0;
+            for (; i + 8 <= _count; i += 8)
+            {
+                __m256 product = _mm256_mul_ps(_mm256_loadu_ps(_values + i), _mm256_loadu_ps(_samples + i));
+                _mm256_storeu_ps(_values + i, product);
+                sum = _mm256_add_ps(sum, product);
+            }
+
+            float lanes[8];
+            _mm256_storeu_ps(lanes, sum);
+
+            float result = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+            for (; i < _count; ++i)
+            {
+                _values[i] *= _samples[i];
+                result += _values[i];
+            }
+
+            return result;
+        }
+
+        // ---- AVX-512 ----
+        ZM_SIMD_TARGET("avx512f") inline void DiffFunctionAvx512(const double * _values, double * _diff, int _dim)
+        {
+            _diff[0] = -_values[0];
+
+            int i = 1;
+            for (; i + 8 <= _dim; i += 8)
+            {
+                _mm512_storeu_pd(_diff + i, _mm512_sub_pd(_mm512_loadu_pd(_values + i - 1), _mm512_loadu_pd(_values + i)));
+            }
+            for (; i < _dim; ++i)
+            {
+                _diff[i] = _values[i - 1] - _values[i];
+            }
+
+            _diff[_dim] = _values[_dim - 1];
+        }
+
+        ZM_SIMD_TARGET("avx512f") inline void DiffFunctionAvx512(const float * _values, float * _diff, int _dim)
+        {
+            _diff[0] = -_values[0];
+
+            int i = 1;
+            for (; i + 16 <= _dim; i += 16)
+            {
+                _mm512_storeu_ps(_diff + i, _mm512_sub_ps(_mm512_loadu_ps(_values + i - 1), _mm512_loadu_ps(_values + i)));
+            }
+            for (; i < _dim; ++i)
+            {
+                _diff[i] = _values[i - 1] - _values[i];
+            }
+
+            _diff[_dim] = _values[_dim - 1];
+        }
+
+        ZM_SIMD_TARGET("avx512f") inline double MultiplySumAvx512(double * _values, const double * _samples, int _count)
+        {
+            __m512d sum = _mm512_setzero_pd();
+
+            int i = 0;
+            for (; i + 8 <= _count; i += 8)
+            {
+                __m512d product = _mm512_mul_pd(_mm512_loadu_pd(_values + i), _mm512_loadu_pd(_samples + i));
+                _mm512_storeu_pd(_values + i, product);
+                sum = _mm512_add_pd(sum, product);
+            }
+
+            double lanes[8];
+            _mm512_storeu_pd(lanes, sum);
+
+            double result = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+            for (; i < _count; ++i)
+            {
+                _values[i] *= _samples[i];
+                result += _values[i];
+            }
+
+            return result;
+        }
+
+        ZM_SIMD_TARGET("avx512f") inline float MultiplySumAvx512(float * _values, const float * _samples, int _count)
+        {
+            __m512 sum = _mm512_setzero_ps();
+
+            int i = 0;
+            for (; i + 16 <= _count; i += 16)
+            {
+                __m512 product = _mm512_mul_ps(_mm512_loadu_ps(_values + i), _mm512_loadu_ps(_samples + i));
+                _mm512_storeu_ps(_values + i, product);
+                sum = _mm512_add_ps(sum, product);
+            }
+
+            float lanes[16];
+            _mm512_storeu_ps(lanes, sum);
+
+            float result = 0;
+            for (int lane = 0; lane < 16; lane += 4)
+            {
+                result += (lanes[lane] + lanes[lane + 1]) + (lanes[lane + 2] + lanes[lane + 3]);
+            }
+            for (; i < _count; ++i)
+            {
+                _values[i] *= _samples[i];
+                result += _values[i];
+            }
+
+            return result;
+        }
+    }
+#endif
+
+    /// The difference function of _dim values into _dim + 1 values, see ScalarDiffFunction()
+    template<class T>
+    void DiffFunction(const T * _values, T * _diff, int _dim)
+    {
+        ScalarDiffFunction(_values, _diff, _dim);
+    }
+
+    /// Multiplies _values by _samples in place and returns the sum, see ScalarMultiplySum()
+    template<class T>
+    T MultiplySum(T * _values, const T * _samples, int _count)
+    {
+        return ScalarMultiplySum(_values, _samples, _count);
+    }
+
+#ifdef ZM_SIMD_X86
+    inline void DiffFunction(const double * _values, double * _diff, int _dim)
+    {
+        switch (GetIsa())
+        {
+        case Isa::avx512:
+            return detail::DiffFunctionAvx512(_values, _diff, _dim);
+        case Isa::avx2:
+            return detail::DiffFunctionAvx2(_values, _diff, _dim);
+        case Isa::sse2:
+            return detail::DiffFunctionSse2(_values, _diff, _dim);
+        default:
+            return ScalarDiffFunction(_values, _diff, _dim);
+        }
+    }
+
+    inline void DiffFunction(const float * _values, float * _diff, int _dim)
+    {
+        switch (GetIsa())
+        {
+        case Isa::avx512:
+            return detail::DiffFunctionAvx512(_values, _diff, _dim);
+        case Isa::avx2:
+            return detail::DiffFunctionAvx2(_values, _diff, _dim);
+        case Isa::sse2:
+            return detail::DiffFunctionSse2(_values, _diff, _dim);
+        default:
+            return ScalarDiffFunction(_values, _diff, _dim);
+        }
+    }
+
+    inline double MultiplySum(double * _values, const double * _samples, int _count)
+    {
+        switch (GetIsa())
+        {
+        case Isa::avx512:
+            return detail::MultiplySumAvx512(_values, _samples, _count);
+        case Isa::avx2:
+            return detail::MultiplySumAvx2(_values, _samples, _count);
+        case Isa::sse2:
+            return detail::MultiplySumSse2(_values, _samples, _count);
+        default:
+            return ScalarMultiplySum(_values, _samples, _count);
+        }
+    }
+
+    inline float MultiplySum(float * _values, const float * _samples, int _count)
+    {
+        switch (GetIsa())
+        {
+        case Isa::avx512:
+            return detail::MultiplySumAvx512(_values, _samples, _count);
+        case Isa::avx2:
+            return detail::MultiplySumAvx2(_values, _samples, _count);
+        case Isa::sse2:
+            return detail::MultiplySumSse2(_values, _samples, _count);
+        default:
+            return ScalarMultiplySum(_values, _samples, _count);
+        }
+    }
+#endif
+}
@@ -0,0 +1,974 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/math/special_functions/binomial.hpp>
+#include <boost/math/special_functions/factorials.hpp>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ----- local program includes -----
+#include "ParallelFor.hpp"
+#include "ScaledGeometricMoments.hpp"
+
+/**
+    Number of Zernike moments [n,l,m] with n <= _order, n - l even and 0 <= m <= l,
+    i.e. the rows of the coefficient table of order _order.
+ */
+inline int ZernikeMomentCount(int _order)
+{
+    int count = 0;
+
+    // all l <= n of the same parity as n, l + 1 values of m each
+    for (int n = 0; n <= _order; ++n)
+    {
+        count += (n / 2 + 1) * (n / 2 + 1 + n % 2);
+    }
+
+    return count;
+}
+
+/**
+    Row of the Zernike moment [n,l,m], m >= 0. The rows are ordered by n, then l,
+    then m as in the coefficient table (see ZernikeCoefficients::GetRow()).
+ */
+inline int ZernikeMomentRow(int _n, int _l, int _m)
+{
+    // the rows of all l' < l with the parity of l
+    return ZernikeMomentCount(_n - 1) + (_l / 2) * (_l / 2 + _l % 2) + _m;
+}
+
+/**
+ * Struct representing a complex coefficient of a moment
+ * of order (p_,q_,r_)
+ */
+template<class T>
+struct ComplexCoeff
+{
+    typedef     std::complex<T>     ValueT;
+
+    /**
+ * Constructor with scalar args
+ */
+    ComplexCoeff(int _p, int _q, int _r, const ValueT & _value) :
+        p_(_p), q_(_q), r_(_r), value_(_value)
+    {
+    }
+
+    /**
+ * Copy constructor
+ */
+    ComplexCoeff(const ComplexCoeff<T> & _cc) : p_(_cc.p_), q_(_cc.q_), r_(_cc.r_), value_(_cc.value_)
+    {
+    }
+
+    ComplexCoeff() : p_(0), q_(0), r_(0)
+    {
+    }
+
+    int                 p_, q_, r_;
+    ValueT     value_;
+};
+
+/**
+ * Class holding all coefficients needed to compute the Zernike moments
+ * from the geometrical moments up to a given order. None of them depend
+ * on the input data, so the table is immutable once built and a single
+ * instance per order is shared by all objects and threads (see Get()).
+ */
+template<class MomentT>
+class ZernikeCoefficients
+{
+public:
+    // ---- public typedefs ----
+    typedef MomentT             T;
+    typedef vector<T>           T1D;        // vector of scalar type
+    typedef vector<T1D>         T2D;        // 2D array of scalar type
+    typedef vector<T2D>         T3D;        // 3D array of scalar type
+
+    typedef std::complex<T>                      ComplexT;       // complex type
+
+    typedef ComplexCoeff<T>                      ComplexCoeffT;
+    typedef vector<ComplexCoeffT>                ComplexCoeffT1D;
+
+public:
+    // ---- public member functions ----
+    /**
+ * Computes all coefficients for Zernike moments up to _order in parallel.
+ * The result doesn't depend on the number of threads.
+ * Prefer Get() which builds the table only once per process.
+ */
+    explicit ZernikeCoefficients(
+        int _order,                 /**< maximal order of the Zernike moments */
+        unsigned _threads = 0       /**< number of threads for computing, 0 means all cores */
+    ) :
+        order_(_order)
+    {
+        static_assert(std::is_floating_point<T>::value, "MomentT must be float, double or long double");
+
+        if (_threads == 0)
+        {
+            _threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        ComputeRowIndices();
+        ComputeMonomialOrders();
+
+        ComputeCs(_threads);
+        ComputeQs(_threads);
+        ComputeGCoefficients(_threads);
+
+        SetArrays(coeffs_.data(), rowOffsets_.data(), imagOffsets_.data(), monomials_.data(), coeffs_.size());
+    }
+
+    ZernikeCoefficients(const ZernikeCoefficients &) = delete;
+    ZernikeCoefficients & operator=(const ZernikeCoefficients &) = delete;
+
+    /**
+ * Returns the shared table for the given order. The table is computed on
+ * the first request and reused afterwards. Thread-safe, only the callers
+ * asking for a table that is being built wait for it.
+ *
+ * If a cache directory is set, the table is memory-mapped from a cache file
+ * instead. A missing, stale or damaged file is (re)written after computing.
+ */
+    static std::shared_ptr<const ZernikeCoefficients> Get(int _order)
+    {
+        typedef std::shared_ptr<const ZernikeCoefficients> TablePtr;
+
+        static std::map<int, std::shared_future<TablePtr> > tables;
+
+        // only the caller building a table allocates the shared state of its future,
+        // a table that is already there is returned without any allocation
+        std::unique_ptr<std::promise<TablePtr> > promise;
+        std::shared_future<TablePtr> table;
+        boost::filesystem::path file;
+
+        // the lock only guards the map, the table is built outside of it
+        {
+            std::lock_guard<std::mutex> lock(Mutex());
+
+            auto found = tables.find(_order);
+
+            if (found != tables.end())
+            {
+                table = found->second;
+            }
+            else
+            {
+                promise = std::make_unique<std::promise<TablePtr> >();
+                table = promise->get_future().share();
+                tables.emplace(_order, table);
+
+                if (!CacheDirectory().empty())
+                {
+                    file = CacheDirectory() / CacheFileName(_order);
+                }
+            }
+        }
+
+        if (promise)
+        {
+            try
+            {
+                promise->set_value(Build(_order, file));
+            }
+            catch (...)
+            {
+                // the waiting callers get the exception, later ones try again
+                {
+                    std::lock_guard<std::mutex> lock(Mutex());
+                    tables.erase(_order);
+                }
+
+                promise->set_exception(std::current_exception());
+            }
+        }
+
+        return table.get();
+    }
+
+    /**
+ * Sets the directory with cached tables used by Get(). An empty path disables the cache.
+ */
+    static void SetCacheDirectory(const boost::filesystem::path & _directory)
+    {
+        std::lock_guard<std::mutex> lock(Mutex());
+
+        CacheDirectory() = _directory;
+    }
+
+    /**
+ * Name of the cache file of the table for the given order and moment type
+ */
+    static std::string CacheFileName(int _order)
+    {
+        return "zernike_coefficients_" + std::to_string(_order) + "_" + std::to_string(sizeof(T)) + ".bin";
+    }
+
+    /**
+ * Maps the table from the file written by Save(). Returns nullptr if the file is missing,
+ * was written by another version, for another order or moment type, or is damaged. The
+ * checks do not detect a forged file, so files that other users could have written are
+ * rejected as well (see IsTrusted()).
+ */
+    static std::shared_ptr<const ZernikeCoefficients> Load(const boost::filesystem::path & _file, int _order)
+    {
+        using namespace boost::interprocess;
+
+        std::unique_ptr<mapped_region> region;
+
+        try
+        {
+            if (!boost::filesystem::is_regular_file(_file) || !IsTrusted(_file))
+            {
+                return nullptr;
+            }
+
+            file_mapping mapping(_file.string().c_str(), read_only);
+            region = std::make_unique<mapped_region>(mapping, read_only);
+        }
+        catch (const std::exception &)
+        {
+            return nullptr;
+        }
+
+        const char * data = static_cast<const char *>(region->get_address());
+        size_t size = region->get_size();
+
+        if (size < sizeof(CacheHeader))
+        {
+            return nullptr;
+        }
+
+        CacheHeader header;
+        std::memcpy(&header, data, sizeof(CacheHeader));
+
+        if (std::memcmp(header.magic, CacheHeader::Magic(), sizeof(header.magic)) != 0 ||
+            header.version != CacheHeader::currentVersion ||
+            header.valueSize != sizeof(T) ||
+            header.valueDigits != std::numeric_limits<T>::digits ||
+            header.order != _order ||
+            header.rowCount != static_cast<std::uint64_t>(ZernikeMomentCount(_order)) ||
+            size != sizeof(CacheHeader) + DataSize(header.rowCount, header.termCount))
+        {
+            return nullptr;
+        }
+
+        boost::crc_32_type crc;
+        crc.process_bytes(data + sizeof(CacheHeader), size - sizeof(CacheHeader));
+
+        if (crc.checksum() != header.checksum)
+        {
+            return nullptr;
+        }
+
+        return std::shared_ptr<const ZernikeCoefficients>(new ZernikeCoefficients(header, std::move(region)));
+    }
+
+    /**
+ * Writes the table into a binary cache file. The file is replaced atomically,
+ * i.e. concurrent readers see either the old or the new file.
+ */
+    bool Save(const boost::filesystem::path & _file) const
+    {
+        using namespace boost::filesystem;
+
+        path tempFile = _file.parent_path() / unique_path(_file.filename().string() + ".%%%%-%%%%-%%%%");
+
+        CacheHeader header{};
+        std::memcpy(header.magic, CacheHeader::Magic(), sizeof(header.magic));
+        header.version = CacheHeader::currentVersion;
+        header.valueSize = sizeof(T);
+        header.valueDigits = std::numeric_limits<T>::digits;
+        header.order = order_;
+        header.rowCount = rowCount_;
+        header.termCount = termCount_;
+        header.generatedTermCount = generatedTermCount_;
+
+        boost::crc_32_type crc;
+        crc.process_bytes(coeffsData_, termCount_ * sizeof(T));
+        crc.process_bytes(rowOffsetsData_, (rowCount_ + 1) * sizeof(int));
+        crc.process_bytes(imagOffsetsData_, rowCount_ * sizeof(int));
+        crc.process_bytes(monomialsData_, termCount_ * sizeof(int));
+        header.checksum = crc.checksum();
+
+        {
+            std::ofstream output(tempFile.string(), std::ios_base::out | std::ios_base::binary);
+
+            if (!output.is_open())
+            {
+                return false;
+            }
+
+            output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            output.write(reinterpret_cast<const char *>(coeffsData_), termCount_ * sizeof(T));
+            output.write(reinterpret_cast<const char *>(rowOffsetsData_), (rowCount_ + 1) * sizeof(int));
+            output.write(reinterpret_cast<const char *>(imagOffsetsData_), rowCount_ * sizeof(int));
+            output.write(reinterpret_cast<const char *>(monomialsData_), termCount_ * sizeof(int));
+
+            if (!output.good())
+            {
+                output.close();
+                remove(tempFile);
+                return false;
+            }
+        }
+
+        boost::system::error_code error;
+
+        // readable by everyone, writable only by the owner, see IsTrusted()
+        permissions(tempFile, owner_read | owner_write | group_read | others_read, error);
+
+        rename(tempFile, _file, error);
+
+        if (error)
+        {
+            remove(tempFile, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    int GetOrder() const
+    {
+        return order_;
+    }
+
+    /*
+     The coefficients are stored as a sparse matrix in CSR format with
+     structure of arrays: there is one row per Zernike moment [n,l,m], m >= 0,
+     and one column per geometrical moment in the flat tetrahedral order
+     (see GeometricalMomentIndex()). Coefficients of the same moment are merged.
+
+     Every coefficient is either real or imaginary (it contains the factor i^p,
+     and the x-order of its moment has the parity of p), so only one real value
+     is stored per coefficient. Each row is split: the real coefficients are
+        GetRowOffsets()[row] .. GetImagOffsets()[row]
+     and the imaginary ones are
+        GetImagOffsets()[row] .. GetRowOffsets()[row + 1]
+    */
+
+    /**
+ * Row of the Zernike moment [n,l,m], m >= 0
+ */
+    int GetRow(int _n, int _l, int _m) const
+    {
+        return firstRows_[_n][_l / 2] + _m;
+    }
+
+    int GetRowCount() const
+    {
+        return rowCount_;
+    }
+
+    const int * GetRowOffsets() const
+    {
+        return rowOffsetsData_;
+    }
+
+    /// first imaginary coefficient of each row
+    const int * GetImagOffsets() const
+    {
+        return imagOffsetsData_;
+    }
+
+    /// indices of the geometrical moments in the flat tetrahedral array
+    const int * GetMonomials() const
+    {
+        return monomialsData_;
+    }
+
+    /// real values of the coefficients, i.e. without the imaginary unit for the imaginary ones
+    const T * GetCoefficients() const
+    {
+        return coeffsData_;
+    }
+
+    /// number of stored coefficients
+    size_t GetTermCount() const
+    {
+        return termCount_;
+    }
+
+    /// number of coefficients before merging of the same moments
+    size_t GetGeneratedTermCount() const
+    {
+        return generatedTermCount_;
+    }
+
+    /**
+ * Coefficient with index _i together with the order of its geometrical moment
+ */
+    ComplexCoeffT GetCoefficient(int _i) const
+    {
+        const int * order = &monomialOrders_[3 * monomialsData_[_i]];
+
+        ComplexT value = order[0] % 2 ? ComplexT(static_cast<T>(0), coeffsData_[_i]) : ComplexT(coeffsData_[_i], static_cast<T>(0));
+
+        return ComplexCoeffT(order[0], order[1], order[2], value);
+    }
+
+private:
+    // ---- private typedefs ----
+    /**
+ * Header of the cache file. It is followed by the coefficients, the row offsets,
+ * the offsets of the imaginary parts and the moment indices.
+ */
+    struct CacheHeader
+    {
+        static constexpr std::uint32_t currentVersion = 1;
+
+        static const char * Magic()
+        {
+            return "ZMCOEFS";
+        }
+
+        char            magic[8];
+        std::uint32_t   version;
+        std::uint32_t   valueSize;          // sizeof(T)
+        std::uint32_t   valueDigits;        // mantissa digits of T
+        std::int32_t    order;
+        std::uint64_t   rowCount;
+        std::uint64_t   termCount;
+        std::uint64_t   generatedTermCount;
+        std::uint32_t   checksum;           // CRC-32 of the data following the header
+        std::uint32_t   reserved[3];
+    };
+
+    static_assert(sizeof(CacheHeader) == 64, "Unexpected size of the cache header");
+    static_assert(sizeof(int) == sizeof(std::int32_t), "int must be 32 bit");
+
+    /**
+ * Coefficients of consecutive rows computed by one task, offsets are relative to the block
+ */
+    struct RowBlock
+    {
+        vector<int>     rowEnds_;
+        vector<int>     imagBegins_;
+        vector<int>     monomials_;
+        T1D             coeffs_;
+        size_t          generatedTermCount_ = 0;
+    };
+
+    // ---- private member functions ----
+    /**
+ * Attaches the table mapped from a cache file, see Load()
+ */
+    ZernikeCoefficients(const CacheHeader & _header, std::unique_ptr<boost::interprocess::mapped_region> _region) :
+        order_(_header.order), generatedTermCount_(_header.generatedTermCount), region_(std::move(_region))
+    {
+        ComputeRowIndices();
+        ComputeMonomialOrders();
+
+        const char * data = static_cast<const char *>(region_->get_address()) + sizeof(CacheHeader);
+        size_t rowCount = _header.rowCount, termCount = _header.termCount;
+
+        const T * coeffs = reinterpret_cast<const T *>(data);
+        const int * rowOffsets = reinterpret_cast<const int *>(data + termCount * sizeof(T));
+        const int * imagOffsets = rowOffsets + rowCount + 1;
+        const int * monomials = imagOffsets + rowCount;
+
+        SetArrays(coeffs, rowOffsets, imagOffsets, monomials, termCount);
+    }
+
+    /**
+ * Maps the table from the cache file _file if it is valid, otherwise computes it
+ * and writes the file. An empty _file disables the cache.
+ */
+    static std::shared_ptr<const ZernikeCoefficients> Build(int _order, const boost::filesystem::path & _file)
+    {
+        std::shared_ptr<const ZernikeCoefficients> table;
+
+        if (!_file.empty())
+        {
+            table = Load(_file, _order);
+        }
+
+        if (!table)
+        {
+            auto computed = std::make_shared<const ZernikeCoefficients>(_order);
+
+            // map the saved file, so the pages are shared with other processes
+            if (!_file.empty() && computed->Save(_file))
+            {
+                table = Load(_file, _order);
+            }
+
+            if (!table)
+            {
+                table = computed;
+            }
+        }
+
+        return table;
+    }
+
+    /**
+ * True if no other user can have written the file: the file and its directory
+ * belong to the current user, and neither is writable by the group or others.
+ * On Windows, the access rights of the per-user directories are relied on.
+ */
+    static bool IsTrusted(const boost::filesystem::path & _file)
+    {
+#ifndef _WIN32
+        auto isPrivate = [](const boost::filesystem::path & _path)
+        {
+            struct stat status;
+
+            return ::stat(_path.c_str(), &status) == 0 &&
+                status.st_uid == ::geteuid() &&
+                (status.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+        };
+
+        boost::filesystem::path directory = boost::filesystem::absolute(_file).parent_path();
+
+        return isPrivate(_file) && isPrivate(directory);
+#else
+        (void)_file;
+        return true;
+#endif
+    }
+
+    static std::mutex & Mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static boost::filesystem::path & CacheDirectory()
+    {
+        static boost::filesystem::path directory;
+        return directory;
+    }
+
+    /**
+ * Size of the cache file data following the header
+ */
+    static std::uint64_t DataSize(std::uint64_t _rowCount, std::uint64_t _termCount)
+    {
+        return _termCount * sizeof(T) + (2 * _rowCount + 1 + _termCount) * sizeof(int);
+    }
+
+    void SetArrays(const T * _coeffs, const int * _rowOffsets, const int * _imagOffsets, const int * _monomials, size_t _termCount)
+    {
+        coeffsData_ = _coeffs;
+        rowOffsetsData_ = _rowOffsets;
+        imagOffsetsData_ = _imagOffsets;
+        monomialsData_ = _monomials;
+        termCount_ = _termCount;
+        rowCount_ = ZernikeMomentCount(order_);
+    }
+
+    /**
+ * Computes the first row of each [n,l]
+ */
+    void ComputeRowIndices()
+    {
+        firstRows_.resize(order_ + 1);
+
+        int row = 0;
+        for (int n = 0; n <= order_; ++n)
+        {
+            firstRows_[n].resize(n / 2 + 1);
+            for (int l = n % 2; l <= n; l += 2)
+            {
+                firstRows_[n][l / 2] = row;
+                row += l + 1;
+            }
+        }
+    }
+
+/**
+ * Computes all the normalizing factors $c_l^m$ for harmonic polynomials e
+ */
+    void ComputeCs(unsigned _threads)
+    {
+        using namespace boost::math;
+
+        /*
+         indexing:
+           l goes from 0 to n
+           m goes from -l to l, in fact from 0 to l, since c(l,-m) = c (l,m)
+        */
+
+        cs_.resize(order_ + 1);
+
+        ParallelFor(order_ + 1, _threads, [this](size_t l)
+        {
+            cs_[l].resize(l + 1);
+            for (size_t m = 0; m <= l; ++m)
+            {
+                /*         T n_sqrt = ((T)2 * l + (T)1) *
+                             Factorial<T>::Get(l + 1, l + m);
+                         T d_sqrt = Factorial<T>::Get(l - m + 1, l);*/
+
+                T n_sqrt = static_cast<T>((2 * l + 1) * rising_factorial(l + 1, m));
+                T d_sqrt = static_cast<T>(rising_factorial(l - m + 1, m));
+
+                cs_[l][m] = std::sqrt(n_sqrt / d_sqrt);
+            }
+        });
+    }
+
+    /**
+ * Computes all coefficients q for orthonormalization of radial polynomials
+ * in Zernike polynomials.
+ */
+    void ComputeQs(unsigned _threads)
+    {
+        using namespace boost::math;
+
+        /*
+         indexing:
+           n goes 0..order_
+           l goes 0..n, so that n-l is even
+           mu goes 0..(n-l)/2
+        */
+
+        qs_.resize(order_ + 1);            // there is order_ + 1 n's
+
+        ParallelFor(order_ + 1, _threads, [this](size_t n)
+        {
+            qs_[n].resize(n / 2 + 1);      // there is floor(n/2) + 1 l's
+
+            size_t l0 = n % 2;
+            for (size_t l = l0; l <= n; l += 2)
+            {
+                size_t k = (n - l) / 2;
+
+                qs_[n][l / 2].resize(k + 1);   // there is k+1 mu's
+
+                for (size_t mu = 0; mu <= k; ++mu)
+                {
+                    T nom = binomial_coefficient<T>(2 * k, k) * // nominator of straight part
+                        binomial_coefficient<T>(k, mu) * binomial_coefficient<T>(2 * (k + l + mu) + 1, 2 * k);
+
+                    if ((k + mu) % 2)
+                    {
+                        nom *= static_cast<T>(-1);
+                    }
+
+                    T den = std::pow(static_cast<T>(2), static_cast<T>(2 * k)) *     // denominator of straight part
+                        binomial_coefficient<T>(k + l + mu, k);
+
+                    T n_sqrt = static_cast<T>(2 * l + 4 * k + 3);      // nominator of sqrt part
+                    T d_sqrt = static_cast<T>(3);                        // denominator of sqrt part
+
+                    qs_[n][l / 2][mu] = nom / den * sqrt(n_sqrt / d_sqrt);
+                }
+            }
+        });
+    }
+
+    /**
+ * Computes the coefficients of geometrical moments in linear combinations
+ * yielding the Zernike moments for each applicable [n,l,m] for n<=order_.
+ * The pairs [n,l] are distributed among the threads, their rows are
+ * concatenated in the order of [n,l] afterwards.
+ */
+    void ComputeGCoefficients(unsigned _threads)
+    {
+        vector<std::pair<int, int> > nls;
+
+        for (int n = 0; n <= order_; ++n)
+        {
+            for (int l = n % 2; l <= n; l += 2)
+            {
+                nls.emplace_back(n, l);
+            }
+        }
+
+        vector<RowBlock> blocks(nls.size());
+
+        // the costly pairs with high n first for a better balance
+        ParallelFor(nls.size(), _threads, [this, &nls, &blocks](size_t i)
+        {
+            size_t task = nls.size() - 1 - i;
+            ComputeGCoefficients(nls[task].first, nls[task].second, blocks[task]);
+        });
+
+        size_t nTerms = 0;
+        generatedTermCount_ = 0;
+
+        for (const RowBlock & block : blocks)
+        {
+            nTerms += block.coeffs_.size();
+            generatedTermCount_ += block.generatedTermCount_;
+        }
+
+        rowOffsets_.assign(1, 0);
+        imagOffsets_.clear();
+        monomials_.clear();
+        coeffs_.clear();
+
+        monomials_.reserve(nTerms);
+        coeffs_.reserve(nTerms);
+
+        for (RowBlock & block : blocks)
+        {
+            int offset = static_cast<int>(coeffs_.size());
+
+            for (size_t row = 0; row < block.rowEnds_.size(); ++row)
+            {
+                imagOffsets_.push_back(offset + block.imagBegins_[row]);
+                rowOffsets_.push_back(offset + block.rowEnds_[row]);
+            }
+
+            monomials_.insert(monomials_.end(), block.monomials_.cbegin(), block.monomials_.cend());
+            coeffs_.insert(coeffs_.end(), block.coeffs_.cbegin(), block.coeffs_.cend());
+
+            block = RowBlock();
+        }
+    }
+
+    /**
+ * Computes the coefficients for all [n,l,m] with the given n and l.
+ * For each such combination the coefficients are stored with according
+ * geom. moment order (see ComplexCoeff).
+ */
+    void ComputeGCoefficients(size_t n, size_t l, RowBlock & _block) const
+    {
+        using namespace boost::math;
+
+        //DD
+        size_t countCoeffs = 0;
+        //DD
+
+        ComplexCoeffT1D rowCoeffs;
+
+        size_t li = l / 2;
+
+        for (size_t m = 0; m <= l; ++m)
+        {
+            rowCoeffs.clear();
+
+            T w = cs_[l][m] / std::pow(static_cast<T>(2), static_cast<T>(m));
+
+            size_t k = (n - l) / 2;
+            for (size_t nu = 0; nu <= k; ++nu)
+            {
+                T w_Nu = w * qs_[n][li][nu];
+                for (size_t alpha = 0; alpha <= nu; ++alpha)
+                {
+                    T w_NuA = w_Nu * binomial_coefficient<T>(nu, alpha);
+                    for (size_t beta = 0; beta <= nu - alpha; ++beta)
+                    {
+                        T w_NuAB = w_NuA * binomial_coefficient<T>(nu - alpha, beta);
+                        for (size_t p = 0; p <= m; ++p)
+                        {
+                            T w_NuABP = w_NuAB * binomial_coefficient<T>(m, p);
+                            for (size_t mu = 0; mu <= (l - m) / 2; ++mu)
+                            {
+                                T w_NuABPMu = w_NuABP *
+                                    binomial_coefficient<T>(l, mu) *
+                                    binomial_coefficient<T>(l - mu, m + mu) /
+                                    static_cast<T>(std::pow(2.0, (double)(2 * mu)));
+                                for (size_t q = 0; q <= mu; ++q)
+                                {
+                                    // the absolute value of the coefficient
+                                    T w_NuABPMuQ = w_NuABPMu * binomial_coefficient<T>(mu, q);
+
+                                    // the sign
+                                    if ((m - p + mu) % 2)
+                                    {
+                                        w_NuABPMuQ *= static_cast<T>(-1);
+                                    }
+
+                                    // * i^p
+                                    size_t rest = p % 4;
+                                    ComplexT c;
+                                    switch (rest)
+                                    {
+                                        case 0: c = ComplexT(w_NuABPMuQ, static_cast <T>(0)); break;
+                                        case 1: c = ComplexT(static_cast<T>(0), w_NuABPMuQ); break;
+                                        case 2: c = ComplexT(static_cast<T>(-1) * w_NuABPMuQ, static_cast<T>(0)); break;
+                                        case 3: c = ComplexT(static_cast<T>(0), static_cast<T>(-1) * w_NuABPMuQ); break;
+                                    }
+
+                                    // determination of the order of according moment
+                                    int z_i = l - m + 2 * (nu - alpha - beta - mu);
+                                    int y_i = 2 * (mu - q + beta) + m - p;
+                                    int x_i = 2 * q + p + 2 * alpha;
+                                    //DD
+                                                                            //std::cout << x_i << " " << y_i << " " << z_i;
+                                                                            //std::cout << "\t" << n << " " << l << " " << m;
+                                                                            //std::cout << "\t" << c.real () << " " << c.imag () << std::endl;
+                                    //DD
+                                    ComplexCoeffT cc(x_i, y_i, z_i, c);
+                                    rowCoeffs.push_back(cc);
+                                    //DD
+                                    countCoeffs++;
+                                    //DD
+                                } // q
+                            } // mu
+                        } // p
+                    } // beta
+                } // alpha
+            } // nu
+
+            AppendRow(rowCoeffs, _block);
+        } // m
+    //DD
+        //std::cout << countCoeffs << std::endl;
+        //DD
+        _block.generatedTermCount_ = countCoeffs;
+    }
+
+    /**
+ * Appends the coefficients of one Zernike moment to the block. Coefficients
+ * of the same geometrical moment are summed up, the real ones are stored first.
+ */
+    void AppendRow(ComplexCoeffT1D & _rowCoeffs, RowBlock & _block) const
+    {
+        // sum up in the order of generation
+        std::stable_sort(_rowCoeffs.begin(), _rowCoeffs.end(), [](const ComplexCoeffT & _a, const ComplexCoeffT & _b)
+        {
+            return std::make_tuple(_a.p_ % 2, _a.p_, _a.q_, _a.r_) < std::make_tuple(_b.p_ % 2, _b.p_, _b.q_, _b.r_);
+        });
+
+        bool imagPart = false;
+
+        for (auto it = _rowCoeffs.cbegin(); it != _rowCoeffs.cend();)
+        {
+            const ComplexCoeffT & cc = *it;
+
+            // the coefficient is i^p * value
+            bool isImag = cc.p_ % 2 != 0;
+            T value{ 0 };
+
+            for (; it != _rowCoeffs.cend() && it->p_ == cc.p_ && it->q_ == cc.q_ && it->r_ == cc.r_; ++it)
+            {
+                value += isImag ? it->value_.imag() : it->value_.real();
+            }
+
+            if (isImag && !imagPart)
+            {
+                _block.imagBegins_.push_back(static_cast<int>(_block.coeffs_.size()));
+                imagPart = true;
+            }
+
+            if (value != static_cast<T>(0))
+            {
+                _block.monomials_.push_back(GeometricalMomentIndex(cc.p_, cc.q_, cc.r_, order_));
+                _block.coeffs_.push_back(value);
+            }
+        }
+
+        if (!imagPart)
+        {
+            _block.imagBegins_.push_back(static_cast<int>(_block.coeffs_.size()));
+        }
+
+        _block.rowEnds_.push_back(static_cast<int>(_block.coeffs_.size()));
+    }
+
+    /**
+ * Builds the inverse of GeometricalMomentIndex() for all moments up to order_
+ */
+    void ComputeMonomialOrders()
+    {
+        monomialOrders_.resize(3 * GeometricalMomentCount(order_));
+
+        for (int i = 0; i <= order_; ++i)
+        {
+            for (int j = 0; j <= order_ - i; ++j)
+            {
+                for (int k = 0; k <= order_ - i - j; ++k)
+                {
+                    int * order = &monomialOrders_[3 * GeometricalMomentIndex(i, j, k, order_)];
+                    order[0] = i;
+                    order[1] = j;
+                    order[2] = k;
+                }
+            }
+        }
+    }
+
+    // ---- private attributes -----
+    int                 order_;             // := max{n} according to indexing of Zernike polynomials
+    size_t              generatedTermCount_; // number of coefficients before merging
+
+    // the table, it points either to the vectors below or to the mapped cache file
+    int                 rowCount_;
+    size_t              termCount_;
+    const int *         rowOffsetsData_;
+    const int *         imagOffsetsData_;
+    const int *         monomialsData_;
+    const T *           coeffsData_;
+
+    std::unique_ptr<boost::interprocess::mapped_region> region_;    // mapped cache file
+
+    vector<int>         rowOffsets_;        // CSR row offsets, one row per [n,l,m]
+    vector<int>         monomials_;         // CSR column indices, i.e. indices of the geometric moments
+    vector<int>         imagOffsets_;       // first imaginary coefficient of each row
+    T1D                 coeffs_;            // real values of the coefficients of the geometric moments
+    vector<vector<int> > firstRows_;        // first row of each [n,l]
+    vector<int>         monomialOrders_;    // (p,q,r) of each geometric moment index
+    T3D                 qs_;                // q coefficients (radial polynomial normalization)
+    T2D                 cs_;                // c coefficients (harmonic polynomial normalization)
+};
\ No newline at end of file
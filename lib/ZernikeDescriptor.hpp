@@ -47,7 +47,12 @@ for more information, see the paper:
 // ---- local program includes ----
 //#include "GeometricalMoments.h"
 #include "ScaledGeometricMoments.hpp"
+#include "RunLengthMoments.hpp"
+#include "IncrementalMoments.hpp"
+#include "BrickMoments.hpp"
+#include "MeshMoments.hpp"
 #include "ZernikeMoments.hpp"
+#include "DirectZernikeMoments.hpp"
 
 /**
  * This class serves as a wrapper around the geometrical and
@@ -69,20 +74,232 @@ public:
 
     using VoxelType = typename std::iterator_traits<InputVoxelIterator>::value_type;
 
+    /// bit grids are normalized word by word
+    using IsBitGrid = IsBitGridIterator<InputVoxelIterator>;
+
     //typedef CumulativeMoments<T, T>                 CumulativeMomentsT;
     typedef ScaledGeometricalMoments<InputVoxelIterator, T>          ScaledGeometricalMomentsT;
+    typedef RunLengthMoments<T>                                      RunLengthMomentsT;
+    typedef IncrementalMoments<T>                                    IncrementalMomentsT;
+    typedef BrickMoments<T>                                          BrickMomentsT;
+    typedef MeshMoments<T>                                           MeshMomentsT;
     typedef ZernikeMoments<InputVoxelIterator, T>                    ZernikeMomentsT;
+    typedef DirectZernikeMoments<InputVoxelIterator, T>              DirectZernikeMomentsT;
+    typedef typename ZernikeMomentsT::MomentsRecordT                 MomentsRecordT;
 
     // ---- public functions ----
     ZernikeDescriptor(
         InputVoxelIterator voxels, /**< the cubic voxel grid */
         size_t _dim,                   /**< dimension is $_dim^3$ */
         size_t _order                  /**< maximal order of the Zernike moments (N in paper) */
+    ) : ZernikeDescriptor(voxels, _dim, _order, true)
+    {
+    }
+
+    /**
+        An empty descriptor, the grids are passed to Compute()
+     */
+    ZernikeDescriptor() : order_(0), dim_(0)
+    {
+    }
+
+    /**
+        If _computeZernike is false, only the geometrical moments are computed.
+        The Zernike moments are then computed for several objects at once
+        (see ZernikeMoments::ComputeBatch()) and passed to SetZernikeMoments().
+        The geometrical moments of large grids may be computed by several
+        threads (see ScaledGeometricalMoments::Init()).
+        The voxels are only read, the cut off by the unit ball is applied while
+        computing the moments. InputVoxelIterator may therefore be a const iterator,
+        a pointer to const data or a BitGrid::const_iterator over mapped words.
+        Grids stored in another axis order, e.g. binvox grids, are read in place
+        with the matching _layout; the moments refer to x, y, z all the same.
+        _memoryLimit bounds the working buffers of the geometrical moments, larger
+        grids are processed in slabs (see ScaledGeometricalMoments::AddSlab()).
+        If _order reaches _wideOrder > 0, the geometrical moments are computed in
+        long double and the Zernike moments of order _wideOrder and above are summed
+        up in long double (see ZernikeMoments::ComputeWide()). GetGeometricalMoments()
+        returns them rounded to T, so a batch computed from those is not wide.
+     */
+    ZernikeDescriptor(
+        InputVoxelIterator voxels, /**< the cubic voxel grid */
+        size_t _dim,                   /**< dimension is $_dim^3$ */
+        size_t _order,                 /**< maximal order of the Zernike moments (N in paper) */
+        bool _computeZernike,          /**< compute the Zernike moments and invariants right away */
+        unsigned _threads = 1,         /**< number of threads for the geometrical moments */
+        VoxelLayout _layout = VoxelLayout::Canonical(), /**< axis order of the grid in memory */
+        std::size_t _memoryLimit = 0,  /**< bytes of the working buffers, 0 for no limit */
+        int _wideOrder = 0             /**< first order computed in long double, 0 for none */
     ) : dim_(_dim), order_(_order)
     {
-        ComputeNormalization(voxels);
-        NormalizeGrid(voxels);
-        ComputeMoments(voxels);
+        // the grid is read twice: once for the normalization, once for the moments
+        ComputeNormalization(voxels, _layout, IsBitGrid());
+
+        if (_wideOrder > 0 && order_ >= static_cast<size_t>(_wideOrder))
+        {
+            ComputeWideMoments(voxels, _computeZernike, _threads, _layout, _memoryLimit, _wideOrder);
+        }
+        else
+        {
+            ComputeMoments(voxels, _computeZernike, _threads, _layout, _memoryLimit);
+        }
+
+        if (_computeZernike)
+        {
+            ComputeInvariants();
+        }
+    }
+
+    /**
+        Computes the Zernike moments directly on the voxels with the recurrences of
+        _direct (see DirectZernikeMoments), there are no geometrical moments. The order
+        is the one of _direct, which may be shared by several descriptors and threads.
+     */
+    ZernikeDescriptor(
+        InputVoxelIterator voxels,                  /**< the cubic voxel grid */
+        size_t _dim,                                /**< dimension is $_dim^3$ */
+        const DirectZernikeMomentsT & _direct,      /**< recurrences of the Zernike polynomials */
+        unsigned _threads = 1,                      /**< number of threads for the Zernike moments */
+        VoxelLayout _layout = VoxelLayout::Canonical() /**< axis order of the grid in memory */
+    ) : order_(_direct.GetOrder()), dim_(_dim)
+    {
+        ComputeNormalization(voxels, _layout, IsBitGrid());
+
+        // the voxels outside the unit ball are cut off as for the geometrical moments
+        T radius = static_cast<T>(1) / scale_;
+
+        typename ZernikeMomentsT::ComplexT1D moments;
+
+        _direct.Compute(voxels, dim_, xCOG_, yCOG_, zCOG_, scale_, radius * radius, moments, _threads, _layout);
+
+        zm_.SetMoments(static_cast<int>(order_), moments);
+
+        ComputeInvariants();
+    }
+
+    /**
+        Computes the descriptor of a binary grid given by the runs of a binvox file
+        without expanding it to single voxels (see RunLengthMoments).
+     */
+    ZernikeDescriptor(
+        const vector<VoxelRun> & _runs,    /**< runs of the cubic voxel grid in the binvox order */
+        size_t _dim,                       /**< dimension is $_dim^3$ */
+        size_t _order,                     /**< maximal order of the Zernike moments (N in paper) */
+        bool _computeZernike = true        /**< compute the Zernike moments and invariants right away */
+    ) : order_(_order), dim_(_dim)
+    {
+        RunLengthMomentsT rm(_runs, static_cast<int>(dim_));
+
+        ComputeNormalization(rm.ComputeSums());
+
+        // the cut off by the unit ball is done while integrating the runs
+        T radius = static_cast<T>(1) / scale_;
+
+        rm.Compute(xCOG_, yCOG_, zCOG_, scale_, order_, radius * radius);
+        geometricalMoments_ = rm.GetMoments();
+
+        ComputeZernikeMoments(_computeZernike);
+
+        if (_computeZernike)
+        {
+            ComputeInvariants();
+        }
+    }
+
+    /**
+        Computes the descriptor of a sparse grid, only its occupied bricks are visited
+        (see BrickMoments).
+     */
+    ZernikeDescriptor(
+        const BrickGrid & _grid,           /**< the sparse voxel grid */
+        size_t _order,                     /**< maximal order of the Zernike moments (N in paper) */
+        bool _computeZernike = true        /**< compute the Zernike moments and invariants right away */
+    ) : order_(_order), dim_(_grid.GetDim())
+    {
+        BrickMomentsT bm(_grid);
+
+        ComputeNormalization(bm.ComputeSums());
+
+        // the cut off by the unit ball is done while integrating the bricks
+        T radius = static_cast<T>(1) / scale_;
+
+        bm.Compute(xCOG_, yCOG_, zCOG_, scale_, order_, radius * radius);
+        geometricalMoments_ = bm.GetMoments();
+
+        ComputeZernikeMoments(_computeZernike);
+
+        if (_computeZernike)
+        {
+            ComputeInvariants();
+        }
+    }
+
+    /**
+        Computes the descriptor of the volume enclosed by a closed triangle mesh from the
+        exact moments of the mesh (see MeshMoments), no voxel grid is involved. The center
+        of gravity and the scale follow from the moments up to order 2 in the same way as
+        for grids, the volume is not cut off by the unit ball. The mesh coordinates are
+        taken as a grid of dimension 1 by Reconstruct().
+     */
+    ZernikeDescriptor(
+        const vector<MeshTriangle> & _triangles,   /**< triangles of the closed mesh */
+        size_t _order,                             /**< maximal order of the Zernike moments (N in paper) */
+        bool _computeZernike = true,               /**< compute the Zernike moments and invariants right away */
+        unsigned _threads = 1                      /**< number of threads for the geometrical moments */
+    ) : order_(_order), dim_(1)
+    {
+        MeshMomentsT mm(_triangles);
+
+        ComputeNormalization(mm, _threads);
+
+        mm.Compute(xCOG_, yCOG_, zCOG_, scale_, order_, _threads);
+        geometricalMoments_ = mm.GetMoments();
+
+        ComputeZernikeMoments(_computeZernike);
+
+        if (_computeZernike)
+        {
+            ComputeInvariants();
+        }
+    }
+
+    /**
+        Computes the descriptor of an edited grid from its raw moments (see IncrementalMoments).
+        The center of gravity and the scale follow from the updated sums, the moments
+        are translated and scaled analytically, so an edit is not followed by a pass
+        over the whole grid unless the unit ball cuts off some voxels.
+     */
+    ZernikeDescriptor(
+        const IncrementalMomentsT & _moments,   /**< raw moments of the edited grid */
+        bool _computeZernike = true             /**< compute the Zernike moments and invariants right away */
+    ) : order_(_moments.GetMaxOrder()), dim_(_moments.GetDim())
+    {
+        ComputeNormalization(_moments.GetSums());
+
+        T radius = static_cast<T>(1) / scale_;
+
+        geometricalMoments_ = _moments.ComputeMoments(xCOG_, yCOG_, zCOG_, scale_, radius * radius);
+
+        ComputeZernikeMoments(_computeZernike);
+
+        if (_computeZernike)
+        {
+            ComputeInvariants();
+        }
+    }
+
+    /**
+        Restores a descriptor from the Zernike moments and the normalization of a record,
+        e.g. one read from a database (see GetMomentsRecord()). The invariants are computed
+        again, the geometrical moments are not available.
+     */
+    explicit ZernikeDescriptor(
+        const MomentsRecordT & _record          /**< moments of a descriptor computed before */
+    ) : order_(_record.order_), dim_(_record.dim_),
+        xCOG_(_record.xCOG_), yCOG_(_record.yCOG_), zCOG_(_record.zCOG_), scale_(_record.scale_)
+    {
+        zm_.SetMoments(_record);
+
         ComputeInvariants();
     }
 
@@ -109,6 +326,33 @@ public:
             _minL, _maxL);
     }
 
+    /**
+        Reconstructs the original object into a cubic grid of _dim^3 values in the order
+        (z * _dim + y) * _dim + x, the layers are evaluated by _threads threads.
+     */
+    void Reconstruct(
+        T * _grid,                  /**< receives _dim^3 values */
+        size_t _dim,                /**< edge of the result grid */
+        int _minN = 0,              /**< min value for n freq index */
+        int _maxN = 100,            /**< max value for n freq index */
+        int _minL = 0,              /**< min value for l freq index */
+        int _maxL = 100,            /**< max value for l freq index */
+        unsigned _threads = 1       /**< number of threads for the layers */
+    )
+    {
+        // the scaling between the reconstruction and original grid
+        T fac = (T)(_dim) / (T)dim_;
+
+        zm_.Reconstruct(_grid, _dim, _dim, _dim,
+            xCOG_ * fac,
+            yCOG_ * fac,
+            zCOG_ * fac,
+            scale_ / fac,
+            _minN, _maxN,
+            _minL, _maxL,
+            _threads);
+    }
+
     /**
      * Saves the computed invariants into a binary file
      */
@@ -153,71 +397,279 @@ public:
         return invariants_;
     }
 
+    /// The invariants without a copy, one per [n,l]
+    const T1D & GetInvariants() const
+    {
+        return invariants_;
+    }
+
+    /**
+        Computes the descriptor of another grid in place, like the constructor with
+        _computeZernike. The buffers of this descriptor and the working buffers of _gm
+        are reused and only grow, so a grid and an order no larger than before allocate
+        nothing with one thread (see GetAllocationCount() and ZernikeEngine).
+     */
+    void Compute(
+        InputVoxelIterator voxels,              /**< the cubic voxel grid */
+        size_t _dim,                            /**< dimension is $_dim^3$ */
+        size_t _order,                          /**< maximal order of the Zernike moments (N in paper) */
+        ScaledGeometricalMomentsT & _gm,        /**< the geometrical moments and their working buffers */
+        unsigned _threads = 1,                  /**< number of threads for the geometrical moments */
+        VoxelLayout _layout = VoxelLayout::Canonical() /**< axis order of the grid in memory */
+    )
+    {
+        dim_ = _dim;
+        order_ = _order;
+
+        ComputeNormalization(voxels, _layout, IsBitGrid());
+
+        T radius = static_cast<T>(1) / scale_;
+
+        _gm.Init(voxels, dim_, dim_, dim_, xCOG_, yCOG_, zCOG_, scale_, order_, _threads, radius * radius, _layout);
+
+        const T1D & moments = _gm.GetMoments();
+
+        FitBuffer(geometricalMoments_, moments.size(), allocations_);
+        std::copy(moments.cbegin(), moments.cend(), geometricalMoments_.begin());
+
+        zm_.Init(order_);
+        zm_.Compute(geometricalMoments_);
+
+        ComputeInvariants();
+    }
+
+    /// Number of invariants up to the given order, one per [n,l]
+    static size_t GetInvariantCount(size_t _order)
+    {
+        size_t count = 0;
+
+        for (size_t n = 0; n <= _order; ++n)
+        {
+            count += n / 2 + 1;
+        }
+
+        return count;
+    }
+
+    /// Number of times Compute() had to grow the buffers of this descriptor
+    std::size_t GetAllocationCount() const
+    {
+        return allocations_ + zm_.GetAllocationCount();
+    }
+
+    /**
+     * Geometrical moments of the normalized object in the flat tetrahedral order
+     */
+    const T1D & GetGeometricalMoments() const
+    {
+        return geometricalMoments_;
+    }
+
+    /**
+     * The Zernike moments together with the center of gravity and the scale they refer to,
+     * e.g. to be stored with the invariants (see MomentsRecord::Write())
+     */
+    MomentsRecordT GetMomentsRecord() const
+    {
+        MomentsRecordT record;
+
+        record.order_ = static_cast<int>(order_);
+        record.dim_ = dim_;
+        record.xCOG_ = xCOG_;
+        record.yCOG_ = yCOG_;
+        record.zCOG_ = zCOG_;
+        record.scale_ = scale_;
+        record.moments_ = zm_.GetMoments();
+
+        return record;
+    }
+
+    /// The Zernike moments, e.g. to rebuild them elsewhere with ZernikeMoments::SetMoments()
+    const ZernikeMomentsT & GetZernikeMoments() const
+    {
+        return zm_;
+    }
+
+    /**
+     * Sets the Zernike moments computed from GetGeometricalMoments() and computes the invariants
+     */
+    void SetZernikeMoments(
+        const ComplexT * _moments   /**< one moment per row of the coefficient table */
+    )
+    {
+        zm_.SetMoments(_moments);
+        ComputeInvariants();
+    }
+
 private:
     // ---- private helper functions ----
     /**
- * Cuts off the function : the object is mapped into the unit ball according to
- * the precomputed center of gravity and scaling factor. All the voxels remaining
- * outside the unit ball are set to zero.
+ * Center of gravity and a scaling factor is computed according to the geometrical
+ * moments and a bounding sphere around the cog. The moments of order 0 and 1
+ * and the sums for the radius variance are collected in one sweep over the grid
+ * in memory order.
  */
-    void NormalizeGrid(InputVoxelIterator voxels)
+    void ComputeNormalization(InputVoxelIterator voxels, const VoxelLayout & _layout, std::false_type)
     {
-        T point[3];
+        static_assert(std::is_floating_point<T>::value, "T must be float, double or long double");
 
-        // it is easier to work with squared radius -> no sqrt required
-        T radius = static_cast<T>(1) / scale_;
-        T sqrRadius = radius * radius;
+        // weighted moments for the center of gravity, binary sums for the radius variance
+        T mass{ 0 }, mass1[3] = { 0, 0, 0 };
+        VoxelSums sums;
 
-        for (size_t x = 0; x < dim_; ++x)
+        InputVoxelIterator iter{ voxels };
+
+        // the coordinates along the memory axes, fastest first
+        std::uint64_t p[3];
+
+        for (p[2] = 0; p[2] < dim_; ++p[2])
         {
-            for (size_t y = 0; y < dim_; ++y)
+            for (p[1] = 0; p[1] < dim_; ++p[1])
             {
-                for (size_t z = 0; z < dim_; ++z)
+                for (p[0] = 0; p[0] < dim_; ++p[0], ++iter)
                 {
-                    size_t index{ (z * dim_ + y) * dim_ + x };
+                    VoxelType value = *iter;
+
+                    if (value == static_cast<VoxelType>(0))
+                    {
+                        continue;
+                    }
+
+                    // the integrated moment of order 1 of a voxel is its value times its center
+                    T weight = static_cast<T>(value);
+
+                    mass += weight;
 
-                    if (voxels[index] != static_cast<VoxelType>(0))
+                    for (int n = 0; n < 3; ++n)
                     {
-                        point[0] = static_cast<T>(x) - xCOG_;
-                        point[1] = static_cast<T>(y) - yCOG_;
-                        point[2] = static_cast<T>(z) - zCOG_;
+                        mass1[n] += weight * (static_cast<T>(p[n]) + static_cast<T>(0.5));
+                    }
 
-                        T sqrLen = point[0] * point[0] + point[1] * point[1] + point[2] * point[2];
+                    if (static_cast<double>(value) > 0.9)
+                    {
+                        sums.count_++;
 
-                        if (sqrLen > sqrRadius)
+                        for (int n = 0; n < 3; ++n)
                         {
-                            voxels[index] = static_cast<VoxelType>(0);
+                            sums.sum_[n] += p[n];
+                            sums.sqrSum_[n] += p[n] * p[n];
                         }
                     }
                 }
             }
         }
+
+        if (mass == static_cast<T>(0))
+        {
+            throw std::runtime_error("No voxels in grid!");
+        }
+
+        // the memory axes are assigned to x, y, z
+        T cog[3];
+
+        for (int n = 0; n < 3; ++n)
+        {
+            cog[_layout.axes_[n]] = mass1[n] / mass;
+        }
+
+        zeroMoment_ = mass;
+        xCOG_ = cog[0];
+        yCOG_ = cog[1];
+        zCOG_ = cog[2];
+
+        ComputeScale(ToGridAxes(sums, _layout));
     }
 
     /**
- * Center of gravity and a scaling factor is computed according to the geometrical
- * moments and a bounding sphere around the cog.
+ * The sums of bit grids are counted word by word (see ComputeVoxelSums()).
  */
-    void ComputeNormalization(InputVoxelIterator voxels)
+    template<class BitGridIterator>
+    void ComputeNormalization(BitGridIterator voxels, const VoxelLayout & _layout, std::true_type)
     {
-        static_assert(std::is_floating_point<T>::value, "T must be float, double or long double");
-        ScaledGeometricalMoments<InputVoxelIterator, T> gm(voxels, dim_, dim_, dim_, 0.0, 0.0, 0.0, 1.0);
+        ComputeNormalization(ToGridAxes(ComputeVoxelSums(voxels, dim_), _layout));
+    }
 
-        // compute the geometrical transform for no translation and scaling, first
-        // to get the 0'th and 1'st order properties of the function
-        //gm.Compute ();
+    /**
+ * The same normalization computed from the exact sums over the voxel centers.
+ */
+    void ComputeNormalization(const VoxelSums & _sums)
+    {
+        if (_sums.count_ == 0)
+        {
+            throw std::runtime_error("No voxels in grid!");
+        }
+
+        // the voxel centers are shifted by one half as in the integrated moments
+        T count = static_cast<T>(_sums.count_);
+
+        zeroMoment_ = count;
+        xCOG_ = (static_cast<T>(_sums.sum_[0]) + static_cast<T>(0.5) * count) / count;
+        yCOG_ = (static_cast<T>(_sums.sum_[1]) + static_cast<T>(0.5) * count) / count;
+        zCOG_ = (static_cast<T>(_sums.sum_[2]) + static_cast<T>(0.5) * count) / count;
 
-        // 0'th order moments -> normalization
-        // 1'st order moments -> center of gravity
-        zeroMoment_ = gm.GetMoment(0, 0, 0);
-        xCOG_ = gm.GetMoment(1, 0, 0) / zeroMoment_;
-        yCOG_ = gm.GetMoment(0, 1, 0) / zeroMoment_;
-        zCOG_ = gm.GetMoment(0, 0, 1) / zeroMoment_;
+        ComputeScale(_sums);
+    }
+
+    /**
+ * The volume and the center of gravity of a mesh from its moments of order 0 and 1,
+ * the radius variance from the moments of order 2 about the center of gravity.
+ */
+    void ComputeNormalization(MeshMomentsT & _moments, unsigned _threads)
+    {
+        _moments.Compute(0, 0, 0, 1, 1, _threads);
+
+        T volume = _moments.GetMoment(0, 0, 0);
 
-        // scaling, so that the function gets mapped into the unit sphere
+        if (!(volume > static_cast<T>(0)))
+        {
+            throw std::runtime_error("The mesh encloses no volume!");
+        }
 
-        //T recScale = ComputeScale_BoundingSphere (voxels_, dim_, xCOG_, yCOG_, zCOG_);
-        T recScale = 2.0 * ComputeScale_RadiusVar(voxels, dim_, xCOG_, yCOG_, zCOG_);
+        zeroMoment_ = volume;
+        xCOG_ = _moments.GetMoment(1, 0, 0) / volume;
+        yCOG_ = _moments.GetMoment(0, 1, 0) / volume;
+        zCOG_ = _moments.GetMoment(0, 0, 1) / volume;
+
+        _moments.Compute(xCOG_, yCOG_, zCOG_, 1, 2, _threads);
+
+        // y and z are paired with the COG as in ComputeScale(), sum of (z - yCOG)^2 is the
+        // central sum plus volume * (zCOG - yCOG)^2, likewise for y
+        T swap = yCOG_ - zCOG_;
+        T sum = _moments.GetMoment(2, 0, 0) + _moments.GetMoment(0, 2, 0) + _moments.GetMoment(0, 0, 2)
+            + static_cast<T>(2) * volume * swap * swap;
+        T recScale = static_cast<T>(2) * std::sqrt(std::max(sum, static_cast<T>(0)) / volume);
+
+        if (recScale == 0.0)
+        {
+            throw std::runtime_error("The mesh encloses no volume!");
+        }
+        scale_ = static_cast<T>(1) / recScale;
+    }
+
+    /**
+ * The scaling factor from the radius variance around the center of gravity.
+ */
+    void ComputeScale(const VoxelSums & _sums)
+    {
+        if (_sums.count_ == 0)
+        {
+            throw std::runtime_error("No voxels in grid!");
+        }
+
+        T count = static_cast<T>(_sums.count_);
+
+        // sum of (p - c)^2 = sum of p^2 - 2 * c * sum of p + count * c^2 per axis; y and z are
+        // paired with the COG in the same way as in ComputeScale_RadiusVar(), whose index swaps them
+        auto sqrSum = [count](std::uint64_t _sqr, std::uint64_t _sum, T _cog)
+        {
+            return static_cast<T>(_sqr) - static_cast<T>(2) * _cog * static_cast<T>(_sum) + count * _cog * _cog;
+        };
+
+        T sum = sqrSum(_sums.sqrSum_[0], _sums.sum_[0], xCOG_)
+            + sqrSum(_sums.sqrSum_[2], _sums.sum_[2], yCOG_)
+            + sqrSum(_sums.sqrSum_[1], _sums.sum_[1], zCOG_);
+
+        T recScale = static_cast<T>(2) * std::sqrt(std::max(sum, static_cast<T>(0)) / count);
 
         if (recScale == 0.0)
         {
@@ -226,13 +678,47 @@ private:
         scale_ = static_cast<T>(1) / recScale;
     }
 
-    void ComputeMoments(InputVoxelIterator voxels)
+    void ComputeMoments(InputVoxelIterator voxels, bool _computeZernike, unsigned _threads, const VoxelLayout & _layout, std::size_t _memoryLimit)
+    {
+        // the voxels outside the unit ball are cut off while computing the moments
+        T radius = static_cast<T>(1) / scale_;
+
+        ScaledGeometricalMomentsT gm(voxels, dim_, dim_, dim_, xCOG_, yCOG_, zCOG_, scale_, order_, _threads, radius * radius, _layout, _memoryLimit);
+
+        geometricalMoments_ = gm.GetMoments();
+
+        ComputeZernikeMoments(_computeZernike);
+    }
+
+    void ComputeWideMoments(InputVoxelIterator voxels, bool _computeZernike, unsigned _threads, const VoxelLayout & _layout, std::size_t _memoryLimit, int _wideOrder)
+    {
+        using WideT = typename ZernikeMomentsT::WideT;
+
+        // the same cut off ball as in ComputeMoments()
+        T radius = static_cast<T>(1) / scale_;
+
+        ScaledGeometricalMoments<InputVoxelIterator, WideT> gm(voxels, dim_, dim_, dim_, xCOG_, yCOG_, zCOG_, scale_, order_, _threads, radius * radius, _layout, _memoryLimit);
+
+        const auto & moments = gm.GetMoments();
+        geometricalMoments_.assign(moments.cbegin(), moments.cend());
+
+        zm_.Init(order_);
+        zm_.SetWideOrder(_wideOrder);
+
+        if (_computeZernike)
+        {
+            zm_.ComputeWide(moments);
+        }
+    }
+
+    void ComputeZernikeMoments(bool _computeZernike)
     {
-        gm_.Init(voxels, dim_, dim_, dim_, xCOG_, yCOG_, zCOG_, scale_, order_);
+        zm_.Init(order_);
 
-        // Zernike moments
-        zm_.Init(order_, gm_);
-        zm_.Compute();
+        if (_computeZernike)
+        {
+            zm_.Compute(geometricalMoments_);
+        }
     }
 
     /**
@@ -241,15 +727,13 @@ private:
  */
     void ComputeInvariants()
     {
-        //invariants_.resize (order_ + 1);
-        invariants_.clear();
-        for (int n = 0; n < order_ + 1; ++n)
-        {
-            //invariants_[n].resize (n/2 + 1);
+        FitBuffer(invariants_, GetInvariantCount(order_), allocations_);
 
-            int l0 = n % 2, li = 0;
+        auto invariant = invariants_.begin();
 
-            for (int l = n % 2; l <= n; ++li, l += 2)
+        for (int n = 0; n < order_ + 1; ++n)
+        {
+            for (int l = n % 2; l <= n; l += 2)
             {
                 T sum{ 0 };
                 for (int m = -l; m <= l; ++m)
@@ -258,8 +742,7 @@ private:
                     sum += std::norm(moment);
                 }
 
-                invariants_.push_back(sqrt(sum));
-                //invariants_[n][li] = std::sqrt (sum);
+                *invariant++ = sqrt(sum);
             }
         }
     }
@@ -367,5 +850,7 @@ private:
 
     ZernikeMomentsT     zm_;
     //CumulativeMomentsT  cm_;
-    ScaledGeometricalMomentsT gm_;
+    T1D                 geometricalMoments_;    // flat tetrahedral array of the geometrical moments
+
+    std::size_t         allocations_ = 0;       // growths of the buffers in Compute()
 };
\ No newline at end of file
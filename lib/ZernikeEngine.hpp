@@ -0,0 +1,113 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+
+#pragma once
+
+// ---- local program includes ----
+#include "ZernikeDescriptor.hpp"
+
+/**
+ * A long-lived engine computing the invariants of one grid after another, e.g. one
+ * per worker thread. The geometrical moments, the Zernike moments and the invariants
+ * are kept between the grids, their buffers only grow with the largest grid and order
+ * seen so far. Grids no larger than the ones before are therefore computed without
+ * any heap allocation when one thread computes them, GetAllocationCount() tells the
+ * number of buffer growths so far. Several threads use buffers of their own per range
+ * of lines in addition.
+ */
+template<class T, class InputVoxelIterator>
+class ZernikeEngine
+{
+public:
+    typedef ZernikeDescriptor<T, InputVoxelIterator>                 DescriptorT;
+    typedef typename DescriptorT::ScaledGeometricalMomentsT          ScaledGeometricalMomentsT;
+
+    /**
+     * Computes the invariants of the grid into _invariants, which has to hold at least
+     * GetInvariantCount(_order) values. Returns the number of invariants written.
+     */
+    size_t Compute(
+        InputVoxelIterator voxels,              /**< the cubic voxel grid */
+        size_t _dim,                            /**< dimension is $_dim^3$ */
+        size_t _order,                          /**< maximal order of the Zernike moments (N in paper) */
+        T * _invariants,                        /**< receives the invariants */
+        size_t _size,                           /**< number of values _invariants can hold */
+        unsigned _threads = 1,                  /**< number of threads for the geometrical moments */
+        VoxelLayout _layout = VoxelLayout::Canonical() /**< axis order of the grid in memory */
+    )
+    {
+        size_t count = DescriptorT::GetInvariantCount(_order);
+
+        if (_size < count)
+        {
+            throw std::invalid_argument("ZernikeEngine<T,InputVoxelIterator>::Compute (): the output holds fewer values than the invariants of the order.");
+        }
+
+        descriptor_.Compute(voxels, _dim, _order, gm_, _threads, _layout);
+
+        const auto & invariants = descriptor_.GetInvariants();
+        std::copy(invariants.cbegin(), invariants.cend(), _invariants);
+
+        return count;
+    }
+
+    static size_t GetInvariantCount(size_t _order)
+    {
+        return DescriptorT::GetInvariantCount(_order);
+    }
+
+    /// Number of times the buffers grew since construction
+    std::size_t GetAllocationCount() const
+    {
+        return gm_.GetAllocationCount() + descriptor_.GetAllocationCount();
+    }
+
+    /// The descriptor of the last grid, e.g. for its Zernike moments
+    const DescriptorT & GetDescriptor() const
+    {
+        return descriptor_;
+    }
+
+private:
+    ScaledGeometricalMomentsT   gm_;            // geometrical moments and their working buffers
+    DescriptorT                 descriptor_;    // normalization, Zernike moments and invariants
+};
@@ -43,38 +43,9 @@ for more information, see the paper:
 
 // ----- local program includes -----
 #include "ScaledGeometricMoments.hpp"
-
-/**
- * Struct representing a complex coefficient of a moment
- * of order (p_,q_,r_)
- */
-template<class T>
-struct ComplexCoeff
-{
-    typedef     std::complex<T>     ValueT;
-
-    /**
- * Constructor with scalar args
- */
-    ComplexCoeff(int _p, int _q, int _r, const ValueT & _value) :
-        p_(_p), q_(_q), r_(_r), value_(_value)
-    {
-    }
-
-    /**
- * Copy constructor
- */
-    ComplexCoeff(const ComplexCoeff<T> & _cc) : p_(_cc.p_), q_(_cc.q_), r_(_cc.r_), value_(_cc.value_)
-    {
-    }
-
-    ComplexCoeff() : p_(0), q_(0), r_(0)
-    {
-    }
-
-    int                 p_, q_, r_;
-    ValueT     value_;
-};
+#include "ZernikeCoefficients.hpp"
+#include "MomentsRecord.hpp"
+#include "ZernikeReconstruction.hpp"
 
 /**
  * Class representing the Zernike moments
@@ -91,16 +62,23 @@ public:
     typedef vector<T3D>         T4D;        // 3D array of scalar type
 
     typedef std::complex<T>                      ComplexT;       // complex type
+    typedef vector<ComplexT>                     ComplexT1D;     // vector of complex type
     typedef vector<vector<vector<ComplexT> > >   ComplexT3D;     // 3D array of complex type
 
     typedef ComplexCoeff<T>                      ComplexCoeffT;
-    typedef vector<vector<vector<vector<ComplexCoeffT> > > >    ComplexCoeffT4D;
+    typedef ZernikeCoefficients<T>               ZernikeCoefficientsT;
+
+    typedef long double                          WideT;          // type of the high orders, see SetWideOrder()
+    typedef vector<WideT>                        WideT1D;
+    typedef ZernikeCoefficients<WideT>           WideCoefficientsT;
+    typedef ScaledGeometricalMoments<InputVoxelIterator, MomentT>   ScaledGeometricalMomentsT;
+    typedef MomentsRecord<T>                     MomentsRecordT;
 
 public:
     // ---- public member functions ----
-    ZernikeMoments(int _order, ScaledGeometricalMoments<InputVoxelIterator, MomentT> & _gm)
+    explicit ZernikeMoments(int _order)
     {
-        Init(_order, _gm);
+        Init(_order);
     }
 
     ZernikeMoments() :
@@ -108,97 +86,348 @@ public:
     {
     }
 
-    /* Todo: Init() doesn't depend on the geomentrical moments.
-     * Removing the  parameter and moving it to Compute() will make the class more efficient to reuse to
-     * compute ZM for several objects at once.
-
-     * Computes all coefficients that are input data independent
-     */
-    void Init(int _order, ScaledGeometricalMoments<InputVoxelIterator, MomentT> & _gm)
+    /**
+ * Attaches the input data independent coefficients for the given order.
+ * They are shared with all other instances of the same order. The table
+ * attached already is kept if the order does not change.
+ */
+    void Init(int _order)
     {
         static_assert(std::is_floating_point<T>::value, "MomentT must be float, double or long double");
-        /* Todo: Init() doesn't depend on the geomentrical moments.
-         * Removing the  parameter and moving it to Compute() will make the class more efficient to reuse to
-         * compute ZM for several objects at once.
-         */
-        gm_ = _gm;
+
+        if (coeffs_ && _order == order_)
+        {
+            return;
+        }
+
         order_ = _order;
+        coeffs_ = ZernikeCoefficientsT::Get(_order);
+        wideCoeffs_.reset();
+    }
+
+    /**
+ * Sets the first order whose Zernike moments ComputeWide() sums up in long double,
+ * 0 for none. The cancellation in the rows of the coefficient table grows with the
+ * order, at order 40 the sums in double lose about 12 digits.
+ */
+    void SetWideOrder(int _wideOrder)
+    {
+        wideOrder_ = std::max(_wideOrder, 0);
+    }
+
+    int GetWideOrder() const
+    {
+        return wideOrder_;
+    }
 
-        ComputeCs();
-        ComputeQs();
-        ComputeGCoefficients();
+    /// Number of times Compute() had to grow the buffer of the Zernike moments
+    std::size_t GetAllocationCount() const
+    {
+        return allocations_;
     }
 
     /**
  * Computes the Zernike moments. This computation is data dependent
  * and has to be performed for each new object and/or transformation.
  */
-    void Compute()
+    void Compute(const ScaledGeometricalMomentsT & _gm)
     {
-        // geometrical moments have to be computed first
-        if (!order_)
+        Compute(_gm.GetMoments());
+    }
+
+    /**
+ * Computes the Zernike moments from the geometrical moments up to order_
+ * given in the flat tetrahedral order (see GeometricalMomentIndex()).
+ * It is a sparse matrix-vector product of the coefficient table and the moments.
+ */
+    void Compute(const T1D & _moments)
+    {
+        // coefficients have to be attached first
+        if (!coeffs_)
         {
             throw std::runtime_error("ZernikeMoments<InputVoxelIterator,MomentT>::ComputeZernikeMoments (): attempting to \
-                     compute Zernike moments without setting valid geometrical \
-                     moments first.");
+                     compute Zernike moments without setting valid order \
+                     first.");
+        }
+
+        if (_moments.size() != static_cast<size_t>(GeometricalMomentCount(order_)))
+        {
+            throw std::invalid_argument("ZernikeMoments<InputVoxelIterator,MomentT>::Compute (): geometrical moments are not of the same order.");
+        }
+
+        constexpr T three_quarters_div_pi = boost::math::constants::three_quarters<T>() * 1 / boost::math::constants::pi<T>();
+
+        const int * rowOffsets = coeffs_->GetRowOffsets();
+        const int * imagOffsets = coeffs_->GetImagOffsets();
+        const int * monomials = coeffs_->GetMonomials();
+        const T * coeffs = coeffs_->GetCoefficients();
+        const T * moments = _moments.data();
+
+        int nRows = coeffs_->GetRowCount();
+
+        FitBuffer(zernikeMoments_, nRows, allocations_);
+
+        for (int row = 0; row < nRows; ++row)
+        {
+            // Zernike moment of according indices [nlm] is sum of conj(c) * moment
+            T real{ 0 }, imag{ 0 };
+
+            int imagBegin = imagOffsets[row];
+            for (int i = rowOffsets[row]; i < imagBegin; ++i)
+            {
+                real += coeffs[i] * moments[monomials[i]];
+            }
+
+            int end = rowOffsets[row + 1];
+            for (int i = imagBegin; i < end; ++i)
+            {
+                imag += coeffs[i] * moments[monomials[i]];
+            }
+
+            zernikeMoments_[row] = ComplexT(real, -imag) * three_quarters_div_pi;
         }
+    }
 
-        /*
-         indexing:
-           n goes 0..order_
-           l goes 0..n so that n-l is even
-           m goes -l..l
-        */
+    /**
+ * Computes the Zernike moments from geometrical moments given in long double, e.g.
+ * by ScaledGeometricalMoments<InputVoxelIterator, long double>. The rows of orders
+ * below the wide order (see SetWideOrder()) are computed as by Compute() with the
+ * moments rounded to T, the rows of the wide order and above are summed up in long
+ * double with the coefficients of the long double table and rounded to T afterwards.
+ * Where long double is double, e.g. with MSVC, this is the same as Compute().
+ */
+    void ComputeWide(const WideT1D & _moments)
+    {
+        if (!coeffs_)
+        {
+            throw std::runtime_error("ZernikeMoments<InputVoxelIterator,MomentT>::ComputeWide (): attempting to \
+                     compute Zernike moments without setting valid order \
+                     first.");
+        }
 
-        T nullMoment;
+        if (_moments.size() != static_cast<size_t>(GeometricalMomentCount(order_)))
+        {
+            throw std::invalid_argument("ZernikeMoments<InputVoxelIterator,MomentT>::ComputeWide (): geometrical moments are not of the same order.");
+        }
 
         constexpr T three_quarters_div_pi = boost::math::constants::three_quarters<T>() * 1 / boost::math::constants::pi<T>();
+        constexpr WideT wide_three_quarters_div_pi = boost::math::constants::three_quarters<WideT>() * 1 / boost::math::constants::pi<WideT>();
+
+        const int nRows = coeffs_->GetRowCount();
+        const int wideRow = wideOrder_ > 0 && wideOrder_ <= order_ ? ZernikeMomentCount(wideOrder_ - 1) : nRows;
 
-        zernikeMoments_.resize(order_ + 1);
-        for (int n = 0; n <= order_; ++n)
+        zernikeMoments_.resize(nRows);
+
+        // rows of the low orders
         {
-            zernikeMoments_[n].resize(n / 2 + 1);
+            const int * rowOffsets = coeffs_->GetRowOffsets();
+            const int * imagOffsets = coeffs_->GetImagOffsets();
+            const int * monomials = coeffs_->GetMonomials();
+            const T * coeffs = coeffs_->GetCoefficients();
 
-            int l0 = n % 2, li = 0;
-            for (int l = l0; l <= n; ++li, l += 2)
+            for (int row = 0; row < wideRow; ++row)
             {
-                zernikeMoments_[n][li].resize(l + 1);
-                for (int m = 0; m <= l; ++m)
+                T real{ 0 }, imag{ 0 };
+
+                int imagBegin = imagOffsets[row];
+                for (int i = rowOffsets[row]; i < imagBegin; ++i)
                 {
-                    // Zernike moment of according indices [nlm]
-                    ComplexT zm(static_cast<T>(0), static_cast<T>(0));
+                    real += coeffs[i] * static_cast<T>(_moments[monomials[i]]);
+                }
 
-                    int nCoeffs = (int)gCoeffs_[n][li][m].size();
-                    for (int i = 0; i < nCoeffs; ++i)
-                    {
-                        ComplexCoeffT cc = gCoeffs_[n][li][m][i];
-                        //T scale = gm_.GetScale ();
-                        //T fact = std::pow (scale, cc.p_+cc.q_+cc.r_+3);
+                int end = rowOffsets[row + 1];
+                for (int i = imagBegin; i < end; ++i)
+                {
+                    imag += coeffs[i] * static_cast<T>(_moments[monomials[i]]);
+                }
+
+                zernikeMoments_[row] = ComplexT(real, -imag) * three_quarters_div_pi;
+            }
+        }
+
+        if (wideRow == nRows)
+        {
+            return;
+        }
+
+        // the table of the high orders is shared as well, but attached on demand only
+        if (!wideCoeffs_)
+        {
+            wideCoeffs_ = WideCoefficientsT::Get(order_);
+        }
+
+        const int * rowOffsets = wideCoeffs_->GetRowOffsets();
+        const int * imagOffsets = wideCoeffs_->GetImagOffsets();
+        const int * monomials = wideCoeffs_->GetMonomials();
+        const WideT * coeffs = wideCoeffs_->GetCoefficients();
+
+        for (int row = wideRow; row < nRows; ++row)
+        {
+            WideT real{ 0 }, imag{ 0 };
+
+            int imagBegin = imagOffsets[row];
+            for (int i = rowOffsets[row]; i < imagBegin; ++i)
+            {
+                real += coeffs[i] * _moments[monomials[i]];
+            }
+
+            int end = rowOffsets[row + 1];
+            for (int i = imagBegin; i < end; ++i)
+            {
+                imag += coeffs[i] * _moments[monomials[i]];
+            }
+
+            zernikeMoments_[row] = ComplexT(static_cast<T>(real * wide_three_quarters_div_pi), static_cast<T>(-imag * wide_three_quarters_div_pi));
+        }
+    }
+
+    /**
+ * Computes the Zernike moments of several objects in one pass over the coefficient
+ * table, i.e. a sparse-dense matrix product. _moments contains the geometrical moments
+ * of _nObjects objects one after another (objects x moments, flat tetrahedral order),
+ * _zernikeMoments receives their Zernike moments in the same manner (objects x rows,
+ * see ZernikeCoefficients::GetRow()). The result of each object is identical to Compute().
+ */
+    void ComputeBatch(const T1D & _moments, size_t _nObjects, ComplexT1D & _zernikeMoments) const
+    {
+        if (!coeffs_)
+        {
+            throw std::runtime_error("ZernikeMoments<InputVoxelIterator,MomentT>::ComputeBatch (): attempting to \
+                     compute Zernike moments without setting valid order \
+                     first.");
+        }
+
+        const size_t nMoments = GeometricalMomentCount(order_);
+
+        if (_moments.size() != nMoments * _nObjects)
+        {
+            throw std::invalid_argument("ZernikeMoments<InputVoxelIterator,MomentT>::ComputeBatch (): geometrical moments are not of the same order.");
+        }
 
-                        //zm +=  std::conj (cc.value_) * gm_.GetMoment(cc.p_, cc.q_, cc.r_) * fact;
-                        zm += std::conj(cc.value_) * gm_.GetMoment(cc.p_, cc.q_, cc.r_);
+        constexpr T three_quarters_div_pi = boost::math::constants::three_quarters<T>() * 1 / boost::math::constants::pi<T>();
+
+        // number of objects processed together, their moments and sums stay in cache
+        constexpr size_t blockSize = 16;
+
+        const int * rowOffsets = coeffs_->GetRowOffsets();
+        const int * imagOffsets = coeffs_->GetImagOffsets();
+        const int * monomials = coeffs_->GetMonomials();
+        const T * coeffs = coeffs_->GetCoefficients();
+
+        const size_t nRows = coeffs_->GetRowCount();
+
+        _zernikeMoments.resize(nRows * _nObjects);
+
+        // moments of a block of objects, transposed to moments x objects
+        T1D block(nMoments * blockSize);
+        T real[blockSize], imag[blockSize];
+
+        for (size_t first = 0; first < _nObjects; first += blockSize)
+        {
+            const size_t nBlock = std::min(blockSize, _nObjects - first);
+
+            for (size_t obj = 0; obj < nBlock; ++obj)
+            {
+                const T * moments = &_moments[(first + obj) * nMoments];
+                for (size_t i = 0; i < nMoments; ++i)
+                {
+                    block[i * blockSize + obj] = moments[i];
+                }
+            }
+
+            for (size_t row = 0; row < nRows; ++row)
+            {
+                std::fill(real, real + blockSize, static_cast<T>(0));
+                std::fill(imag, imag + blockSize, static_cast<T>(0));
+
+                int imagBegin = imagOffsets[row];
+                for (int i = rowOffsets[row]; i < imagBegin; ++i)
+                {
+                    const T * moments = &block[monomials[i] * blockSize];
+                    const T coeff = coeffs[i];
+
+                    for (size_t obj = 0; obj < blockSize; ++obj)
+                    {
+                        real[obj] += coeff * moments[obj];
                     }
+                }
 
-                    zm *= three_quarters_div_pi;
+                int end = rowOffsets[row + 1];
+                for (int i = imagBegin; i < end; ++i)
+                {
+                    const T * moments = &block[monomials[i] * blockSize];
+                    const T coeff = coeffs[i];
 
-                    if (n == 0 && l == 0 && m == 0)
+                    for (size_t obj = 0; obj < blockSize; ++obj)
                     {
-                        // FixMe Unused variable! What is it for?
-                        nullMoment = zm.real();
+                        imag[obj] += coeff * moments[obj];
                     }
-                    zernikeMoments_[n][li][m] = zm;
+                }
 
-                    //std::cout << "zernike moment[nlm]: " << n << "\t" << l << "\t" << m << "\t" << zernikeMoments_[n][li][m] << "\n";
+                for (size_t obj = 0; obj < nBlock; ++obj)
+                {
+                    _zernikeMoments[(first + obj) * nRows + row] = ComplexT(real[obj], -imag[obj]) * three_quarters_div_pi;
                 }
             }
         }
     }
 
-    inline ComplexT GetMoment(int _n, int _l, int _m)
+    /**
+ * Sets the Zernike moments computed elsewhere, e.g. by ComputeBatch().
+ * _moments points to one value per row of the coefficient table.
+ */
+    void SetMoments(const ComplexT * _moments)
+    {
+        zernikeMoments_.assign(_moments, _moments + ZernikeMomentCount(order_));
+    }
+
+    /**
+ * Sets the Zernike moments of order _order computed without geometrical moments,
+ * e.g. by DirectZernikeMoments. The coefficient table is not attached, it is only
+ * needed by Reconstruct() which attaches it on demand.
+ */
+    void SetMoments(int _order, const ComplexT1D & _moments)
+    {
+        if (_moments.size() != static_cast<size_t>(ZernikeMomentCount(_order)))
+        {
+            throw std::invalid_argument("ZernikeMoments<InputVoxelIterator,MomentT>::SetMoments (): Zernike moments are not of the given order.");
+        }
+
+        if (_order != order_)
+        {
+            coeffs_.reset();
+            wideCoeffs_.reset();
+        }
+
+        order_ = _order;
+        zernikeMoments_ = _moments;
+    }
+
+    /**
+ * Restores the Zernike moments stored in a record, e.g. read from a database.
+ * The normalization of the record is kept by ZernikeDescriptor.
+ */
+    void SetMoments(const MomentsRecordT & _record)
+    {
+        SetMoments(_record.order_, _record.moments_);
+    }
+
+    int GetOrder() const
+    {
+        return order_;
+    }
+
+    /// One moment per row of the coefficient table, the ones of m < 0 follow from them
+    const ComplexT1D & GetMoments() const
+    {
+        return zernikeMoments_;
+    }
+
+    inline ComplexT GetMoment(int _n, int _l, int _m) const
     {
         if (_m >= 0)
         {
-            return zernikeMoments_[_n][_l / 2][_m];
+            return zernikeMoments_[ZernikeMomentRow(_n, _l, _m)];
         }
         else
         {
@@ -212,15 +441,47 @@ public:
             {
                 sign = static_cast<T>(1);
             }
-            return sign * std::conj(zernikeMoments_[_n][_l / 2][abs(_m)]);
+            return sign * std::conj(zernikeMoments_[ZernikeMomentRow(_n, _l, abs(_m))]);
+        }
+    }
+
+    /**
+ * The function previously encoded as Zernike moments is evaluated at the points
+ * ((x - _xCOG) * _scale, (y - _yCOG) * _scale, (z - _zCOG) * _scale) and written to
+ * _grid[(z * _yDim + y) * _xDim + x], points outside the unit ball get 0. Only the
+ * moments of orders n in [_minN, _maxN] and l in [_minL, _maxL] contribute. The
+ * layers are evaluated by _threads threads (see ZernikeReconstruction).
+ */
+    void Reconstruct(T * _grid,                         // receives _xDim * _yDim * _zDim values
+        size_t        _xDim,
+        size_t        _yDim,
+        size_t        _zDim,
+        T             _xCOG,                // center of gravity
+        T             _yCOG,
+        T             _zCOG,
+        T             _scale,               // scaling factor to map into unit ball
+        int           _minN = 0,            // min value for n freq index
+        int           _maxN = 100,          // max value for n freq index
+        int           _minL = 0,            // min value for l freq index
+        int           _maxL = 100,          // max value for l freq index
+        unsigned      _threads = 1)         // number of threads for the layers
+    {
+        if (!coeffs_)
+        {
+            Init(order_);
         }
+
+        ZernikeReconstruction<T> reconstruction(*coeffs_, zernikeMoments_.data(), _minN, _maxN, _minL, _maxL);
+
+        reconstruction.Evaluate(_grid, _xDim, _yDim, _zDim, _xCOG, _yCOG, _zCOG, _scale, _threads);
     }
 
     // ---- debug functions/arguments ----
     /**
  * The function previously encoded as complex valued Zernike
  * moments, is reconstructed. _grid is the output grid containing
- * the reconstructed function.
+ * the reconstructed function. The function is real, the imaginary
+ * parts of the moments of m and -m cancel out.
  */
     void Reconstruct(ComplexT3D & _grid,                // grid containing the reconstructed function
         T             _xCOG,                // center of gravity
@@ -232,99 +493,21 @@ public:
         int           _minL = 0,            // min value for l freq index
         int           _maxL = 100)          // max value for l freq index
     {
-        int dimX = _grid.size();
-        int dimY = _grid[0].size();
-        int dimZ = _grid[0][0].size();
+        size_t dimX = _grid.size();
+        size_t dimY = _grid[0].size();
+        size_t dimZ = _grid[0][0].size();
 
-        //scaling
-        T scale = _scale;
+        T1D values(dimX * dimY * dimZ);
 
-        //translation
-        T vx = _xCOG;
-        T vy = _yCOG;
-        T vz = _zCOG;
-
-        T point[3];
+        Reconstruct(values.data(), dimX, dimY, dimZ, _xCOG, _yCOG, _zCOG, _scale, _minN, _maxN, _minL, _maxL);
 
-        if (_maxN == 100)
+        for (size_t x = 0; x < dimX; ++x)
         {
-            _maxN = order_;
-        }
-
-        for (int x = 0; x < dimX; ++x)
-        {
-            std::cout << x << ". layer being processed\n";
-
-            for (int y = 0; y < dimY; ++y)
+            for (size_t y = 0; y < dimY; ++y)
             {
-                for (int z = 0; z < dimZ; ++z)
+                for (size_t z = 0; z < dimZ; ++z)
                 {
-                    // the origin is in the middle of the grid, all voxels are
-                    // projected into the unit ball
-                    point[0] = (static_cast<T>(x) - vx) * scale;
-                    point[1] = (static_cast<T>(y) - vy) * scale;
-                    point[2] = (static_cast<T>(z) - vz) * scale;
-
-                    if (point[0] * point[0] + point[1] * point[1] + point[2] * point[2] > 1.0)
-                    {
-                        continue;
-                    }
-
-                    // function value at point
-                    ComplexT fVal{ 0, 0 };
-
-                    for (int n = _minN; n <= _maxN; ++n)
-                        //for (int n=14; n<=14; ++n)
-                    {
-                        int maxK = n / 2;
-                        for (int k = 0; k <= maxK; ++k)
-                        {
-                            for (int nu = 0; nu <= k; ++nu)
-                            {
-                                int l = n - 2 * k;
-                                // check whether l is within bounds
-                                if (l < _minL || l > _maxL)
-                                {
-                                    continue;
-                                }
-
-                                for (int m = -l; m <= l; ++m)
-                                {
-                                    // zernike polynomial evaluated at point
-                                    ComplexT zp(0, 0);
-
-                                    int absM = std::abs(m);
-
-                                    int nCoeffs = gCoeffs_[n][l / 2][absM].size();
-                                    for (int i = 0; i < nCoeffs; ++i)
-                                    {
-                                        ComplexCoeffT cc = gCoeffs_[n][l / 2][absM][i];
-                                        ComplexT cvalue = cc.value_;
-
-                                        // conjugate if m negative
-                                        if (m < 0)
-                                        {
-                                            cvalue = std::conj(cvalue);
-
-                                            // take care of the sign
-                                            if (m % 2)
-                                            {
-                                                cvalue *= (T)(-1);
-                                            }
-                                        }
-
-                                        zp += cvalue *
-                                            std::pow(point[0], (T)cc.p_) *
-                                            std::pow(point[1], (T)cc.q_) *
-                                            std::pow(point[2], (T)cc.r_);
-                                    }
-
-                                    fVal += zp * GetMoment(n, l, m);
-                                }
-                            }
-                        }
-                    }
-                    _grid[x][y][z] = fVal;
+                    _grid[x][y][z] = ComplexT(values[(z * dimY + y) * dimX + x], static_cast<T>(0));
                 }
             }
         }
@@ -371,22 +554,27 @@ public:
 
     void CheckOrthonormality(int _n1, int _l1, int _m1, int _n2, int _l2, int _m2)
     {
-        int li1 = _l1 / 2;
-        int li2 = _l2 / 2;
         int dim = 64;
 
+        if (!coeffs_)
+        {
+            Init(order_);
+        }
+
         // the total sum of the scalar product
         ComplexT sum(static_cast<T>(0), static_cast<T>(0));
 
-        int nCoeffs1 = (int)gCoeffs_[_n1][li1][_m1].size();
-        int nCoeffs2 = (int)gCoeffs_[_n2][li2][_m2].size();
+        const int * rowOffsets = coeffs_->GetRowOffsets();
 
-        for (int i = 0; i < nCoeffs1; ++i)
+        int row1 = coeffs_->GetRow(_n1, _l1, _m1);
+        int row2 = coeffs_->GetRow(_n2, _l2, _m2);
+
+        for (int i = rowOffsets[row1]; i < rowOffsets[row1 + 1]; ++i)
         {
-            ComplexCoeffT cc1 = gCoeffs_[_n1][li1][_m1][i];
-            for (int j = 0; j < nCoeffs2; ++j)
+            ComplexCoeffT cc1 = coeffs_->GetCoefficient(i);
+            for (int j = rowOffsets[row2]; j < rowOffsets[row2 + 1]; ++j)
             {
-                ComplexCoeffT cc2 = gCoeffs_[_n2][li2][_m2][j];
+                ComplexCoeffT cc2 = coeffs_->GetCoefficient(j);
 
                 T temp{ 0 };
 
@@ -406,193 +594,14 @@ public:
     }
 
 private:
-    // ---- private member functions ----
-
-/**
- * Computes all the normalizing factors $c_l^m$ for harmonic polynomials e
- */
-    void ComputeCs()
-    {
-        using namespace boost::math;
-
-        /*
-         indexing:
-           l goes from 0 to n
-           m goes from -l to l, in fact from 0 to l, since c(l,-m) = c (l,m)
-        */
-
-        cs_.resize(order_ + 1);
-
-        for (size_t l = 0; l <= order_; ++l)
-        {
-            cs_[l].resize(l + 1);
-            for (size_t m = 0; m <= l; ++m)
-            {
-                /*         T n_sqrt = ((T)2 * l + (T)1) *
-                             Factorial<T>::Get(l + 1, l + m);
-                         T d_sqrt = Factorial<T>::Get(l - m + 1, l);*/
-
-                T n_sqrt = static_cast<T>((2 * l + 1) * rising_factorial(l + 1, m));
-                T d_sqrt = static_cast<T>(rising_factorial(l - m + 1, m));
-
-                cs_[l][m] = std::sqrt(n_sqrt / d_sqrt);
-            }
-        }
-    }
-
-    /**
- * Computes all coefficients q for orthonormalization of radial polynomials
- * in Zernike polynomials.
- */
-    void ComputeQs()
-    {
-        using namespace boost::math;
-
-        /*
-         indexing:
-           n goes 0..order_
-           l goes 0..n, so that n-l is even
-           mu goes 0..(n-l)/2
-        */
-
-        qs_.resize(order_ + 1);            // there is order_ + 1 n's
-
-        for (size_t n = 0; n <= order_; ++n)
-        {
-            qs_[n].resize(n / 2 + 1);      // there is floor(n/2) + 1 l's
-
-            size_t l0 = n % 2;
-            for (size_t l = l0; l <= n; l += 2)
-            {
-                size_t k = (n - l) / 2;
-
-                qs_[n][l / 2].resize(k + 1);   // there is k+1 mu's
-
-                for (size_t mu = 0; mu <= k; ++mu)
-                {
-                    T nom = binomial_coefficient<T>(2 * k, k) * // nominator of straight part
-                        binomial_coefficient<T>(k, mu) * binomial_coefficient<T>(2 * (k + l + mu) + 1, 2 * k);
-
-                    if ((k + mu) % 2)
-                    {
-                        nom *= static_cast<T>(-1);
-                    }
-
-                    T den = std::pow(static_cast<T>(2), static_cast<T>(2 * k)) *     // denominator of straight part
-                        binomial_coefficient<T>(k + l + mu, k);
-
-                    T n_sqrt = static_cast<T>(2 * l + 4 * k + 3);      // nominator of sqrt part
-                    T d_sqrt = static_cast<T>(3);                        // denominator of sqrt part
-
-                    qs_[n][l / 2][mu] = nom / den * sqrt(n_sqrt / d_sqrt);
-                }
-            }
-        }
-    }
-
-    /**
- * Computes the coefficients of geometrical moments in linear combinations
- * yielding the Zernike moments for each applicable [n,l,m] for n<=order_.
- * For each such combination the coefficients are stored with according
- * geom. moment order (see ComplexCoeff).
- */
-    void ComputeGCoefficients()
-    {
-        using namespace boost::math;
-
-        //DD
-        size_t countCoeffs = 0;
-        //DD
-        gCoeffs_.resize(order_ + 1);
-
-        for (size_t n = 0; n <= order_; ++n)
-        {
-            gCoeffs_[n].resize(n / 2 + 1);
-            size_t li = 0, l0 = n % 2;
-            for (size_t l = l0; l <= n; ++li, l += 2)
-            {
-                gCoeffs_[n][li].resize(l + 1);
-                for (size_t m = 0; m <= l; ++m)
-                {
-                    T w = cs_[l][m] / std::pow(static_cast<T>(2), static_cast<T>(m));
-
-                    size_t k = (n - l) / 2;
-                    for (size_t nu = 0; nu <= k; ++nu)
-                    {
-                        T w_Nu = w * qs_[n][li][nu];
-                        for (size_t alpha = 0; alpha <= nu; ++alpha)
-                        {
-                            T w_NuA = w_Nu * binomial_coefficient<T>(nu, alpha);
-                            for (size_t beta = 0; beta <= nu - alpha; ++beta)
-                            {
-                                T w_NuAB = w_NuA * binomial_coefficient<T>(nu - alpha, beta);
-                                for (size_t p = 0; p <= m; ++p)
-                                {
-                                    T w_NuABP = w_NuAB * binomial_coefficient<T>(m, p);
-                                    for (size_t mu = 0; mu <= (l - m) / 2; ++mu)
-                                    {
-                                        T w_NuABPMu = w_NuABP *
-                                            binomial_coefficient<T>(l, mu) *
-                                            binomial_coefficient<T>(l - mu, m + mu) /
-                                            static_cast<T>(std::pow(2.0, (double)(2 * mu)));
-                                        for (size_t q = 0; q <= mu; ++q)
-                                        {
-                                            // the absolute value of the coefficient
-                                            T w_NuABPMuQ = w_NuABPMu * binomial_coefficient<T>(mu, q);
-
-                                            // the sign
-                                            if ((m - p + mu) % 2)
-                                            {
-                                                w_NuABPMuQ *= static_cast<T>(-1);
-                                            }
-
-                                            // * i^p
-                                            size_t rest = p % 4;
-                                            ComplexT c;
-                                            switch (rest)
-                                            {
-                                                case 0: c = ComplexT(w_NuABPMuQ, static_cast <T>(0)); break;
-                                                case 1: c = ComplexT(static_cast<T>(0), w_NuABPMuQ); break;
-                                                case 2: c = ComplexT(static_cast<T>(-1) * w_NuABPMuQ, static_cast<T>(0)); break;
-                                                case 3: c = ComplexT(static_cast<T>(0), static_cast<T>(-1) * w_NuABPMuQ); break;
-                                            }
-
-                                            // determination of the order of according moment
-                                            int z_i = l - m + 2 * (nu - alpha - beta - mu);
-                                            int y_i = 2 * (mu - q + beta) + m - p;
-                                            int x_i = 2 * q + p + 2 * alpha;
-                                            //DD
-                                                                                    //std::cout << x_i << " " << y_i << " " << z_i;
-                                                                                    //std::cout << "\t" << n << " " << l << " " << m;
-                                                                                    //std::cout << "\t" << c.real () << " " << c.imag () << std::endl;
-                                            //DD
-                                            ComplexCoeffT cc(x_i, y_i, z_i, c);
-                                            gCoeffs_[n][li][m].push_back(cc);
-                                            //DD
-                                            countCoeffs++;
-                                            //DD
-                                        } // q
-                                    } // mu
-                                } // p
-                            } // beta
-                        } // alpha
-                    } // nu
-                } // m
-            } // l
-        } // n
-    //DD
-        //std::cout << countCoeffs << std::endl;
-        //DD
-    }
-
     // ---- private attributes -----
-    ComplexCoeffT4D     gCoeffs_;           // coefficients of the geometric moments
-    ComplexT3D          zernikeMoments_;    // nomen est omen
-    T3D                 qs_;                // q coefficients (radial polynomial normalization)
-    T2D                 cs_;                // c coefficients (harmonic polynomial normalization)
+    std::shared_ptr<const ZernikeCoefficientsT> coeffs_;   // shared coefficients of the geometric moments
+    std::shared_ptr<const WideCoefficientsT> wideCoeffs_;  // the same in long double, see ComputeWide()
+    ComplexT1D          zernikeMoments_;    // nomen est omen, one per row of the coefficient table
 
-    ScaledGeometricalMoments<InputVoxelIterator, MomentT> gm_;
     int                 order_;             // := max{n} according to indexing of Zernike polynomials
+    int                 wideOrder_ = 0;     // first order summed up in long double by ComputeWide(), 0 for none
+    std::size_t         allocations_ = 0;   // growths of zernikeMoments_ in Compute()
 
     // ---- debug functions/arguments ----
     void PrintGrid(ComplexT3D & _grid)
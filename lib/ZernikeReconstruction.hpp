@@ -0,0 +1,275 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+/*
+
+                          3D Zernike Moments
+    Copyright (C) 2003 by Computer Graphics Group, University of Bonn
+           http://www.cg.cs.uni-bonn.de/project-pages/3dsearch/
+
+Code by Marcin Novotni:     marcin@cs.uni-bonn.de
+
+for more information, see the paper:
+
+@inproceedings{novotni-2003-3d,
+    author = {M. Novotni and R. Klein},
+    title = {3{D} {Z}ernike Descriptors for Content Based Shape Retrieval},
+    booktitle = {The 8th ACM Symposium on Solid Modeling and Applications},
+    pages = {216--225},
+    year = {2003},
+    month = {June},
+    institution = {Universit\"{a}t Bonn},
+    conference = {The 8th ACM Symposium on Solid Modeling and Applications, June 16-20, Seattle, WA}
+}
+ *---------------------------------------------------------------------------*
+ *                                                                           *
+ *                                License                                    *
+ *                                                                           *
+ *  This library is free software; you can redistribute it and/or modify it  *
+ *  under the terms of the GNU Library General Public License as published   *
+ *  by the Free Software Foundation, version 2.                              *
+ *                                                                           *
+ *  This library is distributed in the hope that it will be useful, but      *
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of               *
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU        *
+ *  Library General Public License for more details.                         *
+ *                                                                           *
+ *  You should have received a copy of the GNU Library General Public        *
+ *  License along with this library; if not, write to the Free Software      *
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.                *
+ *                                                                           *
+\*===========================================================================*/
+
+
+#pragma once
+
+// ---- std includes ---
+#include <algorithm>
+#include <complex>
+#include <vector>
+
+// ---- local program includes ----
+#include "ParallelFor.hpp"
+#include "ZernikeCoefficients.hpp"
+
+/**
+ * Evaluates the function encoded by Zernike moments on a grid (see ZernikeMoments::Reconstruct()).
+ * The moments are summed up into one weight per monomial x^p y^q z^r first, the terms of m and -m
+ * of a moment give twice the real part of the one of m. The function is then a dense polynomial
+ * of order N, which is evaluated separably: per layer the weights collapse to a polynomial in x
+ * and y, per line to one in x, which is summed up with the powers of x from a table. The layers
+ * are distributed over threads, the grid is written in the order (z * yDim + y) * xDim + x.
+ */
+template<class T>
+class ZernikeReconstruction
+{
+public:
+    typedef std::complex<T>             ComplexT;
+    typedef std::vector<T>              T1D;
+    typedef ZernikeCoefficients<T>      ZernikeCoefficientsT;
+
+    /**
+ * Sums up the moments of orders n in [_minN, _maxN] and l in [_minL, _maxL] into the weights
+ * of the monomials. _moments holds one moment per row of _coeffs.
+ */
+    ZernikeReconstruction(
+        const ZernikeCoefficientsT & _coeffs,   // polynomials of the moments
+        const ComplexT * _moments,              // moments in the order of ZernikeMomentRow()
+        int _minN,                              // min value for n freq index
+        int _maxN,                              // max value for n freq index
+        int _minL,                              // min value for l freq index
+        int _maxL                               // max value for l freq index
+    ) : order_(_coeffs.GetOrder()), stride_(_coeffs.GetOrder() + 1), powerStride_(std::max(_coeffs.GetOrder() + 1, 3))
+    {
+        weights_.assign(stride_ * stride_ * stride_, static_cast<T>(0));
+
+        // degrees of the monomials in the flat tetrahedral order of the table
+        std::vector<int> degrees;
+        degrees.reserve(3 * GeometricalMomentCount(order_));
+
+        for (int p = 0; p <= order_; ++p)
+        {
+            for (int q = 0; q <= order_ - p; ++q)
+            {
+                for (int r = 0; r <= order_ - p - q; ++r)
+                {
+                    degrees.push_back(p);
+                    degrees.push_back(q);
+                    degrees.push_back(r);
+                }
+            }
+        }
+
+        const int * rowOffsets = _coeffs.GetRowOffsets();
+        const int * imagOffsets = _coeffs.GetImagOffsets();
+        const int * monomials = _coeffs.GetMonomials();
+        const T * coeffs = _coeffs.GetCoefficients();
+
+        for (int n = std::max(_minN, 0); n <= std::min(_maxN, order_); ++n)
+        {
+            for (int l = n % 2; l <= n; l += 2)
+            {
+                if (l < _minL || l > _maxL)
+                {
+                    continue;
+                }
+
+                for (int m = 0; m <= l; ++m)
+                {
+                    int row = ZernikeMomentRow(n, l, m);
+
+                    // the coefficients are real or imaginary, the weight is the real part of their product with the moment
+                    T factor = m > 0 ? static_cast<T>(2) : static_cast<T>(1);
+                    T real = factor * _moments[row].real();
+                    T imag = -factor * _moments[row].imag();
+
+                    int imagBegin = imagOffsets[row];
+                    int end = rowOffsets[row + 1];
+
+                    for (int i = rowOffsets[row]; i < end; ++i)
+                    {
+                        const int * degree = &degrees[3 * monomials[i]];
+
+                        weights_[(degree[0] * stride_ + degree[1]) * stride_ + degree[2]] += coeffs[i] * (i < imagBegin ? real : imag);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+ * Writes the value at ((x - _xCOG) * _scale, (y - _yCOG) * _scale, (z - _zCOG) * _scale) to
+ * _grid[(z * _yDim + y) * _xDim + x]. Points outside the unit ball get 0.
+ */
+    void Evaluate(
+        T * _grid,              // receives _xDim * _yDim * _zDim values
+        size_t _xDim,
+        size_t _yDim,
+        size_t _zDim,
+        T _xCOG,                // center of gravity
+        T _yCOG,
+        T _zCOG,
+        T _scale,               // scaling factor to map into unit ball
+        unsigned _threads = 1   // number of threads for the layers
+    ) const
+    {
+        T1D xPowers, yPowers, zPowers;
+
+        ComputePowers(_xDim, _xCOG, _scale, xPowers);
+        ComputePowers(_yDim, _yCOG, _scale, yPowers);
+        ComputePowers(_zDim, _zCOG, _scale, zPowers);
+
+        ParallelForRanges(_zDim, _threads, [&](size_t _begin, size_t _end)
+        {
+            // the weights collapsed to x and y per layer and to x per line
+            T1D layer(stride_ * stride_), line(stride_);
+
+            for (size_t z = _begin; z < _end; ++z)
+            {
+                T * out = _grid + z * _yDim * _xDim;
+                const T * zPower = &zPowers[z * powerStride_];
+
+                // the squared distance from the center is the sum of the second powers
+                T zSqr = zPower[2];
+
+                if (zSqr > static_cast<T>(1))
+                {
+                    std::fill(out, out + _yDim * _xDim, static_cast<T>(0));
+                    continue;
+                }
+
+                for (int p = 0; p <= order_; ++p)
+                {
+                    for (int q = 0; q <= order_ - p; ++q)
+                    {
+                        const T * weight = &weights_[(p * stride_ + q) * stride_];
+
+                        T sum{ 0 };
+                        for (int r = 0; r <= order_ - p - q; ++r)
+                        {
+                            sum += weight[r] * zPower[r];
+                        }
+
+                        layer[p * stride_ + q] = sum;
+                    }
+                }
+
+                for (size_t y = 0; y < _yDim; ++y, out += _xDim)
+                {
+                    const T * yPower = &yPowers[y * powerStride_];
+                    T yzSqr = zSqr + yPower[2];
+
+                    if (yzSqr > static_cast<T>(1))
+                    {
+                        std::fill(out, out + _xDim, static_cast<T>(0));
+                        continue;
+                    }
+
+                    for (int p = 0; p <= order_; ++p)
+                    {
+                        const T * weight = &layer[p * stride_];
+
+                        T sum{ 0 };
+                        for (int q = 0; q <= order_ - p; ++q)
+                        {
+                            sum += weight[q] * yPower[q];
+                        }
+
+                        line[p] = sum;
+                    }
+
+                    for (size_t x = 0; x < _xDim; ++x)
+                    {
+                        const T * xPower = &xPowers[x * powerStride_];
+
+                        if (yzSqr + xPower[2] > static_cast<T>(1))
+                        {
+                            out[x] = static_cast<T>(0);
+                            continue;
+                        }
+
+                        T sum{ 0 };
+                        for (int p = 0; p <= order_; ++p)
+                        {
+                            sum += line[p] * xPower[p];
+                        }
+
+                        out[x] = sum;
+                    }
+                }
+            }
+        });
+    }
+
+    int GetOrder() const
+    {
+        return order_;
+    }
+
+private:
+    /**
+ * Powers 0..N of the scaled coordinates of the _dim points of an axis, N + 1 per point
+ * and at least 3, so the squared coordinate is always at hand
+ */
+    void ComputePowers(size_t _dim, T _cog, T _scale, T1D & _powers) const
+    {
+        _powers.resize(_dim * powerStride_);
+
+        for (size_t i = 0; i < _dim; ++i)
+        {
+            T coord = (static_cast<T>(i) - _cog) * _scale;
+            T * power = &_powers[i * powerStride_];
+
+            power[0] = static_cast<T>(1);
+
+            for (int p = 1; p < powerStride_; ++p)
+            {
+                power[p] = power[p - 1] * coord;
+            }
+        }
+    }
+
+    int     order_;         // maximal order of the polynomial (N in paper)
+    int     stride_;        // N + 1, the weights are stored in a cube of that edge
+    int     powerStride_;   // powers per point, N + 1 but at least 3
+    T1D     weights_;       // weight of x^p y^q z^r at (p * stride_ + q) * stride_ + r
+};
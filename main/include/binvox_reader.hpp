@@ -4,31 +4,20 @@
 
 #include "stdafx.h"
 #include "loggers.h"
+#include "RunLengthMoments.hpp"
 
 namespace io
 {
     namespace binvox
     {
         // Original code was imported https://www.patrickmin.com/binvox/read_binvox.cc and slightly modified
-        template<typename VoxelType>
-        bool read_binvox(const boost::filesystem::path & path_to_file, std::vector<VoxelType> & voxels, std::size_t & dim)
+        // Reads the header and leaves the stream at the beginning of the run-length encoded data.
+        inline bool read_binvox_header(std::ifstream & input, std::size_t & dim)
         {
-            static_assert(std::is_integral<VoxelType>::value || std::is_floating_point<VoxelType>::value, "Voxel type must be integral or float");
-
             logging::logger_t & logger = logging::logger_io::get();
 
-            using byte = unsigned char;
-
             dim = 0;
 
-            std::ifstream input{ path_to_file.string(), std::ios::in | std::ios::binary };
-
-            if (!input.is_open())
-            {
-                BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Cannot open file " << path_to_file << std::endl;
-                return false;
-            }
-
             // read header
             std::string line;
 
@@ -121,7 +110,37 @@ namespace io
                 return false;
             }
 
-            std::size_t size = width * height * depth;
+            input.unsetf(std::ifstream::skipws);  // need to read every byte now (!)
+            input.get();  // read the linefeed char
+
+            return input.good();
+        }
+
+        template<typename VoxelType>
+        bool read_binvox(const boost::filesystem::path & path_to_file, std::vector<VoxelType> & voxels, std::size_t & dim)
+        {
+            static_assert(std::is_integral<VoxelType>::value || std::is_floating_point<VoxelType>::value, "Voxel type must be integral or float");
+
+            logging::logger_t & logger = logging::logger_io::get();
+
+            using byte = unsigned char;
+
+            dim = 0;
+
+            std::ifstream input{ path_to_file.string(), std::ios::in | std::ios::binary };
+
+            if (!input.is_open())
+            {
+                BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Cannot open file " << path_to_file << std::endl;
+                return false;
+            }
+
+            if (!read_binvox_header(input, dim))
+            {
+                return false;
+            }
+
+            std::size_t size = dim * dim * dim;
 
             voxels.resize(size);
 
@@ -132,14 +151,6 @@ namespace io
 
             std::size_t index{ 0 }, end_index{ 0 }, nr_voxels{ 0 };
 
-            input.unsetf(std::ifstream::skipws);  // need to read every byte now (!)
-            input >> value;  // read the linefeed char
-
-            if (!input.good())
-            {
-                return false;
-            }
-
             while ((end_index < size) && input.good())
             {
                 input >> value >> count;
@@ -178,5 +189,98 @@ namespace io
 
             return true;
         }
+
+        // Reads the run-length encoded voxels without expanding them. Runs are in the binvox order:
+        // x is the slowest coordinate, y is the fastest.
+        inline bool read_binvox_runs(const boost::filesystem::path & path_to_file, std::vector<VoxelRun> & runs, std::size_t & dim)
+        {
+            logging::logger_t & logger = logging::logger_io::get();
+
+            using byte = unsigned char;
+
+            dim = 0;
+            runs.clear();
+
+            std::ifstream input{ path_to_file.string(), std::ios::in | std::ios::binary };
+
+            if (!input.is_open())
+            {
+                BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Cannot open file " << path_to_file << std::endl;
+                return false;
+            }
+
+            if (!read_binvox_header(input, dim))
+            {
+                return false;
+            }
+
+            std::size_t size = dim * dim * dim;
+
+            byte value{}, count{};
+
+            std::size_t end_index{ 0 }, nr_voxels{ 0 };
+
+            while ((end_index < size) && input.good())
+            {
+                input >> value >> count;
+
+                if (!input.good())
+                {
+                    return false;
+                }
+
+                end_index += count;
+
+                if (end_index > size)
+                {
+                    BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Too many values in voxel. Size is incorrect" << std::endl;
+                    return false;
+                }
+
+                runs.push_back(VoxelRun{ value, count });
+
+                if (value)
+                {
+                    nr_voxels += count;
+                }
+            }
+
+            BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Read " << nr_voxels << " voxels in " << runs.size() << " runs" << std::endl;
+
+            return true;
+        }
+
+        // Expands the runs into a bit grid in the binvox order, the runs are set word by word.
+        inline void runs_to_bit_grid(const std::vector<VoxelRun> & runs, BitGrid & voxels, std::size_t dim)
+        {
+            voxels.resize(dim * dim * dim);
+
+            std::size_t index{ 0 };
+
+            for (const VoxelRun & run : runs)
+            {
+                if (run.value_)
+                {
+                    voxels.SetRange(index, index + run.count_);
+                }
+
+                index += run.count_;
+            }
+        }
+
+        // Reads the voxels into a bit grid in the binvox order (see VoxelLayout::Binvox()).
+        inline bool read_binvox(const boost::filesystem::path & path_to_file, BitGrid & voxels, std::size_t & dim)
+        {
+            std::vector<VoxelRun> runs;
+
+            if (!read_binvox_runs(path_to_file, runs, dim))
+            {
+                return false;
+            }
+
+            runs_to_bit_grid(runs, voxels, dim);
+
+            return true;
+        }
     }
 }
\ No newline at end of file
@@ -4,20 +4,69 @@
 
 #include "stdafx.h"
 #include "binvox_reader.hpp"
+#include "mesh_reader.hpp"
 #include "ZernikeDescriptor.hpp"
 #include "loggers.h"
-#include "binvox_utils.hpp"
 #include "compute_sha256.h"
 #include "sqlite_row.hpp"
 #include "path_tree.hpp"
 
 namespace parallel
 {
-    // Queue stores an absolute path as two parts: parent path and path relative to directory with data.
-    using TasksQueue = boost::lockfree::stack <std::tuple<boost::filesystem::path, boost::filesystem::path, std::string>, boost::lockfree::fixed_sized<true>>;
+    using DescriptorType = double;
+    // type of the orders from the wide order on, see ZernikeMoments::ComputeWide()
+    using WideType = ZernikeMoments<BitGrid::const_iterator, DescriptorType>::WideT;
 
+    // Engine computing the moments
+    enum class MomentsEngine
+    {
+        dense,  // expand the voxels and integrate them one by one
+        runs,   // integrate the run-length encoded voxels of binvox files directly
+        direct  // evaluate the Zernike polynomials on the voxels, no geometrical moments
+    };
+
+    // Counts a worker as busy while it processes a file, also if it returns early.
+    struct BusyWorker
+    {
+        explicit BusyWorker(std::atomic_size_t & busy_workers) : _busy_workers(busy_workers)
+        {
+            ++_busy_workers;
+        }
+
+        ~BusyWorker()
+        {
+            --_busy_workers;
+        }
+
+        BusyWorker(const BusyWorker &) = delete;
+        BusyWorker & operator=(const BusyWorker &) = delete;
+
+    private:
+        std::atomic_size_t & _busy_workers;
+    };
+
+    // A task stores an absolute path as two parts: parent path and path relative to directory with data,
+    // the hash of the file and the ascending orders whose descriptors are missing in the database.
+    using Task = std::tuple<boost::filesystem::path, boost::filesystem::path, std::string, std::vector<int>>;
+
+    using TasksQueue = boost::lockfree::stack <Task, boost::lockfree::fixed_sized<true>>;
+
+    // orders are ascending and unique, the moments of each file are computed once for the last one
     void recursive_compute(const boost::filesystem::path & input_dir,
-        int max_order, std::size_t max_queue_size, std::size_t max_worker_thread, sqlite::database & db);
+        const std::vector<int> & orders, std::size_t max_queue_size, std::size_t max_worker_thread, MomentsEngine engine,
+        std::size_t memory_limit, int wide_order, bool store_moments, sqlite::database & db);
+
+    // The invariants of order n are the first GetInvariantCount(n) invariants of any higher order.
+    // Stores the rows of the missing orders that a stored descriptor of a higher order covers
+    // and returns the orders which still need the voxels.
+    std::vector<int> serve_from_stored(const std::string & generic_path, const std::string & file_hash,
+        const std::vector<int> & missing_orders, sqlite::database & db);
 
-    void compute_descriptor(TasksQueue & queue, int max_order, std::atomic_bool & is_stop, sqlite::database & db);
+    // Workers share the threads of idle workers to compute large grids when the queue is empty.
+    // memory_limit bounds the working buffers of the dense engine in bytes, 0 means no limit.
+    // If max_order reaches wide_order > 0, grids are computed with long double moments one by one.
+    // A row is stored for each order of a task, all of them are sliced from the descriptor of max_order.
+    // If store_moments is set, the row of max_order stores the complex Zernike moments as well (see MomentsRecord).
+    void compute_descriptor(TasksQueue & queue, int max_order, MomentsEngine engine, std::size_t memory_limit, int wide_order, bool store_moments, std::size_t max_thread,
+        std::atomic_size_t & busy_workers, std::atomic_bool & is_stop, sqlite::database & db);
 }
\ No newline at end of file
@@ -42,6 +42,12 @@ namespace db
             return u8"descriptor";
         }
 
+        // complex Zernike moments with their normalization, see MomentsRecord, NULL if not stored
+        static constexpr const char * moments_column()
+        {
+            return u8"moments";
+        }
+
         static constexpr const char * table_name()
         {
             return u8"zernike_descriptors";
@@ -58,7 +64,8 @@ namespace db
                 << max_order_column() << u8" INTEGER NOT NULL CHECK(" << max_order_column() << u8" > 0), "
                 << desc_length_column() << u8" INTEGER NOT NULL CHECK(" << desc_length_column() << u8" > 0),"
                 << desc_value_size_bytes_column() << u8" INTEGER NOT NULL CHECK(" << desc_value_size_bytes_column() << u8" > 0),"
-                << descriptor_column() << u8" BLOB"
+                << descriptor_column() << u8" BLOB,"
+                << moments_column() << u8" BLOB"
                 << ')';
 
             return query.str();
@@ -69,6 +76,22 @@ namespace db
             std::string ddl_query{ create_table_ddl() };
             db << ddl_query;
 
+            // databases created before the moments were stored lack their column
+            {
+                std::stringstream column_query;
+                column_query << u8"SELECT count(*) FROM pragma_table_info('" << table_name() << u8"') WHERE name = '" << moments_column() << u8"'";
+
+                int count{ 0 };
+                db << column_query.str() >> count;
+
+                if (count == 0)
+                {
+                    std::stringstream alter_query;
+                    alter_query << u8"ALTER TABLE " << table_name() << u8" ADD COLUMN " << moments_column() << u8" BLOB";
+                    db << alter_query.str();
+                }
+            }
+
             {
                 std::stringstream file_hash_index_query;
                 file_hash_index_query << u8"CREATE INDEX IF NOT EXISTS hash_index ON " << table_name() << u8" (" << file_hash_column() << ')';
@@ -0,0 +1,287 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+#pragma once
+
+#include "stdafx.h"
+#include "loggers.h"
+#include "MeshMoments.hpp"
+
+namespace io
+{
+    namespace mesh
+    {
+        // A binary STL is an 80 byte header, the number of triangles and 50 bytes per triangle:
+        // the normal, three vertices as 32 bit floats and a 16 bit attribute.
+        inline bool read_stl_binary(std::ifstream & input, std::uintmax_t file_size, std::vector<MeshTriangle> & triangles)
+        {
+            logging::logger_t & logger = logging::logger_io::get();
+
+            input.seekg(80, std::ios::beg);
+
+            std::uint32_t count{ 0 };
+
+            input.read(reinterpret_cast<char *>(&count), sizeof(count));
+
+            if (!input.good() || file_size < 84 + 50 * static_cast<std::uintmax_t>(count))
+            {
+                BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Binary STL is shorter than " << count << " triangles" << std::endl;
+                return false;
+            }
+
+            triangles.resize(count);
+
+            char record[50];
+
+            for (std::uint32_t t{ 0 }; t < count; t++)
+            {
+                input.read(record, sizeof(record));
+
+                if (!input.good())
+                {
+                    return false;
+                }
+
+                for (int v{ 0 }; v < 3; v++)
+                {
+                    for (int n{ 0 }; n < 3; n++)
+                    {
+                        float coord;
+                        std::memcpy(&coord, record + 12 * (v + 1) + 4 * n, sizeof(coord));
+                        triangles[t].vertices_[v][n] = coord;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        // An ASCII STL lists the vertices of each facet after the keyword 'vertex'.
+        inline bool read_stl_ascii(std::ifstream & input, std::vector<MeshTriangle> & triangles)
+        {
+            logging::logger_t & logger = logging::logger_io::get();
+
+            input.seekg(0, std::ios::beg);
+
+            MeshTriangle triangle{};
+            int vertex{ 0 };
+
+            std::string word;
+
+            while (input >> word)
+            {
+                if (word == "vertex")
+                {
+                    if (vertex == 3)
+                    {
+                        BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Facet with more than three vertices" << std::endl;
+                        return false;
+                    }
+
+                    input >> triangle.vertices_[vertex][0] >> triangle.vertices_[vertex][1] >> triangle.vertices_[vertex][2];
+
+                    if (input.fail())
+                    {
+                        return false;
+                    }
+
+                    vertex++;
+                }
+                else if (word == "endfacet")
+                {
+                    if (vertex != 3)
+                    {
+                        BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Facet with " << vertex << " vertices" << std::endl;
+                        return false;
+                    }
+
+                    triangles.push_back(triangle);
+                    vertex = 0;
+                }
+            }
+
+            return true;
+        }
+
+        // Reads a binary or an ASCII STL file. Some binary files start with 'solid' as well,
+        // so a file is binary if its size matches the number of triangles in the header.
+        inline bool read_stl(const boost::filesystem::path & path_to_file, std::vector<MeshTriangle> & triangles)
+        {
+            logging::logger_t & logger = logging::logger_io::get();
+
+            triangles.clear();
+
+            std::ifstream input{ path_to_file.string(), std::ios::in | std::ios::binary };
+
+            if (!input.is_open())
+            {
+                BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Cannot open file " << path_to_file << std::endl;
+                return false;
+            }
+
+            boost::system::error_code error;
+            std::uintmax_t file_size = boost::filesystem::file_size(path_to_file, error);
+
+            if (error)
+            {
+                return false;
+            }
+
+            char header[84] = {};
+
+            input.read(header, sizeof(header));
+
+            bool is_binary{ false };
+
+            if (input.good())
+            {
+                std::uint32_t count;
+                std::memcpy(&count, header + 80, sizeof(count));
+
+                is_binary = file_size == 84 + 50 * static_cast<std::uintmax_t>(count) || std::strncmp(header, "solid", 5) != 0;
+            }
+
+            input.clear();
+
+            bool is_read = is_binary ? read_stl_binary(input, file_size, triangles) : read_stl_ascii(input, triangles);
+
+            if (is_read)
+            {
+                BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Read " << triangles.size() << " triangles" << std::endl;
+            }
+
+            return is_read;
+        }
+
+        // Reads the vertices and the faces of an OBJ file, everything else is skipped. The face
+        // corners may carry texture and normal indices (v/vt/vn), negative indices count from
+        // the last vertex read so far. Polygons are split into a fan of triangles.
+        inline bool read_obj(const boost::filesystem::path & path_to_file, std::vector<MeshTriangle> & triangles)
+        {
+            logging::logger_t & logger = logging::logger_io::get();
+
+            triangles.clear();
+
+            std::ifstream input{ path_to_file.string() };
+
+            if (!input.is_open())
+            {
+                BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Cannot open file " << path_to_file << std::endl;
+                return false;
+            }
+
+            std::vector<std::array<double, 3>> vertices;
+            std::vector<std::size_t> face;
+
+            std::string line, word;
+
+            while (std::getline(input, line))
+            {
+                std::istringstream tokens{ line };
+
+                if (!(tokens >> word))
+                {
+                    continue;
+                }
+
+                if (word == "v")
+                {
+                    std::array<double, 3> vertex;
+
+                    if (!(tokens >> vertex[0] >> vertex[1] >> vertex[2]))
+                    {
+                        BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Invalid vertex [" << line << "]" << std::endl;
+                        return false;
+                    }
+
+                    vertices.push_back(vertex);
+                }
+                else if (word == "f")
+                {
+                    face.clear();
+
+                    while (tokens >> word)
+                    {
+                        long long index{ 0 };
+
+                        try
+                        {
+                            index = std::stoll(word);
+                        }
+                        catch (const std::logic_error &)
+                        {
+                            BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Invalid face [" << line << "]" << std::endl;
+                            return false;
+                        }
+
+                        if (index < 0)
+                        {
+                            index += static_cast<long long>(vertices.size()) + 1;
+                        }
+
+                        if (index < 1 || index > static_cast<long long>(vertices.size()))
+                        {
+                            BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Vertex index out of range [" << line << "]" << std::endl;
+                            return false;
+                        }
+
+                        face.push_back(static_cast<std::size_t>(index - 1));
+                    }
+
+                    for (std::size_t i{ 2 }; i < face.size(); i++)
+                    {
+                        MeshTriangle triangle;
+
+                        const std::size_t corners[3] = { face[0], face[i - 1], face[i] };
+
+                        for (int v{ 0 }; v < 3; v++)
+                        {
+                            for (int n{ 0 }; n < 3; n++)
+                            {
+                                triangle.vertices_[v][n] = vertices[corners[v]][n];
+                            }
+                        }
+
+                        triangles.push_back(triangle);
+                    }
+                }
+            }
+
+            BOOST_LOG_SEV(logger, logging::severity_t::trace) << "Read " << vertices.size() << " vertices and " << triangles.size() << " triangles" << std::endl;
+
+            return true;
+        }
+
+        inline std::string lower_extension(const boost::filesystem::path & path_to_file)
+        {
+            std::string extension{ path_to_file.extension().string() };
+
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+            return extension;
+        }
+
+        inline bool is_mesh_file(const boost::filesystem::path & path_to_file)
+        {
+            std::string extension{ lower_extension(path_to_file) };
+
+            return extension == ".stl" || extension == ".obj";
+        }
+
+        // Reads the triangles of an STL or an OBJ file, the format follows from the extension.
+        inline bool read_mesh(const boost::filesystem::path & path_to_file, std::vector<MeshTriangle> & triangles)
+        {
+            std::string extension{ lower_extension(path_to_file) };
+
+            if (extension == ".stl")
+            {
+                return read_stl(path_to_file, triangles);
+            }
+            else if (extension == ".obj")
+            {
+                return read_obj(path_to_file, triangles);
+            }
+
+            return false;
+        }
+    }
+}
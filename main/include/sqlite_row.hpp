@@ -4,6 +4,7 @@
 
 #include "stdafx.h"
 #include "db.h"
+#include "MomentsRecord.hpp"
 
 namespace sqldata
 {
@@ -14,12 +15,22 @@ namespace sqldata
         std::string file_hash;
         std::vector <DescriptorType> descriptor;
         int max_order;
+        // blob of MomentsRecord<DescriptorType>, empty if the moments are not stored
+        std::vector<unsigned char> moments;
 
-        Row(const std::string & generic_path, const std::string & hash, const std::vector <DescriptorType> & descriptor, int max_order) : generic_path(generic_path), file_hash(hash), descriptor(descriptor), max_order(max_order)
+        Row(const std::string & generic_path, const std::string & hash, const std::vector <DescriptorType> & descriptor, int max_order,
+            std::vector<unsigned char> moments = {}) : generic_path(generic_path), file_hash(hash), descriptor(descriptor), max_order(max_order), moments(std::move(moments))
         {
         }
     };
 
+    // NULL if the moments are not stored
+    template<typename DescriptorType>
+    std::unique_ptr<std::vector<unsigned char>> moments_blob(const Row<DescriptorType> & row)
+    {
+        return row.moments.empty() ? nullptr : std::make_unique<std::vector<unsigned char>>(row.moments);
+    }
+
     template<typename DescriptorType>
     sqlite::database & operator<<(sqlite::database & db, const Row<DescriptorType> & row)
     {
@@ -33,14 +44,16 @@ namespace sqldata
             << DbSchema::desc_length_column() << ','
             << DbSchema::desc_value_size_bytes_column() << ','
             << DbSchema::descriptor_column() << ','
-            << DbSchema::max_order_column() << u8") VALUES (?, ?, ?, ?, ?, ?)";
+            << DbSchema::max_order_column() << ','
+            << DbSchema::moments_column() << u8") VALUES (?, ?, ?, ?, ?, ?, ?)";
         db << insert_query.str()
             << row.generic_path
             << row.file_hash
             << row.descriptor.size()
             << sizeof(DescriptorType)
             << row.descriptor
-            << row.max_order;
+            << row.max_order
+            << moments_blob(row);
 
         return db;
     }
@@ -53,7 +66,8 @@ namespace sqldata
             << row.descriptor.size()
             << sizeof(DescriptorType)
             << row.descriptor
-            << row.max_order;
+            << row.max_order
+            << moments_blob(row);
         db_binder++;
 
         return db_binder;
@@ -93,7 +107,8 @@ namespace sqldata
                 << DbSchema::desc_length_column() << ','
                 << DbSchema::desc_value_size_bytes_column() << ','
                 << DbSchema::descriptor_column() << ','
-                << DbSchema::max_order_column() << u8") VALUES (?, ?, ?, ?, ?, ?)";
+                << DbSchema::max_order_column() << ','
+                << DbSchema::moments_column() << u8") VALUES (?, ?, ?, ?, ?, ?, ?)";
 
             auto query = db << insert_query.str();
 
@@ -123,4 +138,38 @@ namespace sqldata
     private:
         std::vector < RowT> _rows;
     };
+
+    // Reads the Zernike moments stored with the descriptor of max_order of a file, so the
+    // moments can be restored (see ZernikeDescriptor(const MomentsRecord &)) without the voxels.
+    // Returns false if there is no such descriptor or its moments were not stored.
+    template<typename DescriptorType>
+    bool read_moments(sqlite::database & db, const std::string & generic_path, int max_order, MomentsRecord<DescriptorType> & record)
+    {
+        std::stringstream select_query;
+
+        using namespace db;
+
+        select_query << u8"SELECT " << DbSchema::moments_column() << u8" FROM " << DbSchema::table_name()
+            << u8" WHERE " << DbSchema::path_column() << u8" = ? AND " << DbSchema::max_order_column() << u8" = ? AND "
+            << DbSchema::moments_column() << u8" IS NOT NULL LIMIT 1";
+
+        std::vector<unsigned char> blob;
+
+        db << select_query.str()
+            << generic_path
+            << max_order
+            >> [&blob](std::vector<unsigned char> moments) -> void
+        {
+            blob = std::move(moments);
+        };
+
+        if (blob.empty())
+        {
+            return false;
+        }
+
+        record = MomentsRecord<DescriptorType>::Read(blob);
+
+        return true;
+    }
 }
\ No newline at end of file
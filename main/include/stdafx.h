@@ -17,6 +17,11 @@
 #include <sstream>
 #include <set>
 #include <stack>
+#include <array>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
 
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
@@ -2,7 +2,8 @@
 // PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
 #include "compute_descriptors.h"
 
-void parallel::recursive_compute(const boost::filesystem::path & input_dir, int max_order, std::size_t queue_size, std::size_t max_thread, sqlite::database & db)
+void parallel::recursive_compute(const boost::filesystem::path & input_dir, const std::vector<int> & orders, std::size_t queue_size, std::size_t max_thread, MomentsEngine engine,
+    std::size_t memory_limit, int wide_order, bool store_moments, sqlite::database & db)
 {
     using namespace std;
     using namespace boost::filesystem;
@@ -10,12 +11,17 @@ void parallel::recursive_compute(const boost::filesystem::path & input_dir, int
 
     logger_t & logger = logger_main::get();
 
+    // the descriptors of all orders are sliced from the one of the maximum order
+    const int max_order{ orders.back() };
+
     TasksQueue all_voxel_paths{ queue_size };
 
     vector<thread> working_threads{ max_thread };
 
     atomic_bool is_stop{ false };
 
+    atomic_size_t busy_workers{ 0 };
+
     using NodeType = tree::Node<std::string>;
 
     tree::PathTree<NodeType> tree{ "" };
@@ -30,9 +36,24 @@ void parallel::recursive_compute(const boost::filesystem::path & input_dir, int
         return;
     }
 
+    // Coefficients do not depend on voxels. Build them once and share between all workers.
+    {
+        auto coeffs = ZernikeCoefficients<DescriptorType>::Get(max_order);
+
+        BOOST_LOG_SEV(logger, severity_t::debug) << u8"Coefficient table for max_order = " << max_order << u8" has "
+            << coeffs->GetTermCount() << u8" terms (" << coeffs->GetGeneratedTermCount() << u8" before merging)" << endl;
+
+        if (engine != MomentsEngine::direct && wide_order > 0 && max_order >= wide_order)
+        {
+            ZernikeCoefficients<WideType>::Get(max_order);
+
+            BOOST_LOG_SEV(logger, severity_t::debug) << u8"Orders from " << wide_order << u8" on are computed in long double" << endl;
+        }
+    }
+
     for (size_t i{ 0 }; i < working_threads.size(); i++)
     {
-        working_threads.at(i) = thread(compute_descriptor, ref(all_voxel_paths), max_order, ref(is_stop), ref(db));
+        working_threads.at(i) = thread(compute_descriptor, ref(all_voxel_paths), max_order, engine, memory_limit, wide_order, store_moments, max_thread, ref(busy_workers), ref(is_stop), ref(db));
     }
 
     auto iterator = recursive_directory_iterator(input_dir);
@@ -52,7 +73,7 @@ void parallel::recursive_compute(const boost::filesystem::path & input_dir, int
         {
             path local_file{ entry.path() };
 
-            if (local_file.extension() == u8".binvox")
+            if (local_file.extension() == u8".binvox" || io::mesh::is_mesh_file(local_file))
             {
                 BOOST_LOG_SEV(logger, severity_t::info) << u8"Found " << local_file << endl;
 
@@ -69,7 +90,7 @@ void parallel::recursive_compute(const boost::filesystem::path & input_dir, int
 
                 path relative_path = relative(local_file, input_dir);
 
-                bool need_recompute{ true };
+                vector<int> missing_orders{ orders };
 
                 if (!is_new_node)
                 {
@@ -94,18 +115,22 @@ void parallel::recursive_compute(const boost::filesystem::path & input_dir, int
                     {
                         stringstream select_query;
 
-                        long count{};
-
-                        select_query << u8"SELECT count(*) FROM " << db::DbSchema::table_name()
-                            << " WHERE " << db::DbSchema::path_column() << " = ? AND "
-                            << db::DbSchema::max_order_column() << " = ?";
+                        select_query << u8"SELECT " << db::DbSchema::max_order_column() << u8" FROM " << db::DbSchema::table_name()
+                            << " WHERE " << db::DbSchema::path_column() << " = ?";
 
                         try
                         {
                             db << select_query.str()
                                 << relative_path.generic_string()
-                                << max_order
-                                >> count;
+                                >> [&missing_orders](int stored_order) -> void
+                            {
+                                missing_orders.erase(remove(missing_orders.begin(), missing_orders.end(), stored_order), missing_orders.end());
+                            };
+
+                            if (!missing_orders.empty())
+                            {
+                                missing_orders = serve_from_stored(relative_path.generic_string(), file_hash, missing_orders, db);
+                            }
                         }
                         catch (const sqlite::sqlite_exception & exc)
                         {
@@ -113,21 +138,16 @@ void parallel::recursive_compute(const boost::filesystem::path & input_dir, int
                             continue;
                         }
 
-                        if (count > 0)
-                        {
-                            need_recompute = false;
-                        }
-
-                        if (need_recompute)
+                        if (!missing_orders.empty())
                         {
-                            BOOST_LOG_SEV(logger, severity_t::debug) << u8"Cannot find computed descriptor for: " << local_file << u8" when max_order = " << max_order << u8" Need recompute." << endl;
+                            BOOST_LOG_SEV(logger, severity_t::debug) << u8"Cannot find computed descriptor for: " << local_file << u8" when max_order = " << missing_orders.back() << u8" Need recompute." << endl;
                         }
                     }
                 }
 
-                if (need_recompute)
+                if (!missing_orders.empty())
                 {
-                    tuple<path, path, string> item = std::make_tuple(input_dir, relative_path, file_hash);
+                    Task item = std::make_tuple(input_dir, relative_path, file_hash, missing_orders);
 
                     while (!all_voxel_paths.push(item) && !is_stop)
                     {
@@ -136,7 +156,7 @@ void parallel::recursive_compute(const boost::filesystem::path & input_dir, int
                 }
                 else
                 {
-                    BOOST_LOG_SEV(logger, severity_t::info) << u8"File: " << local_file << u8" with hash: " << file_hash << u8" and max_order = " << max_order << u8" already exists. Skip" << endl;
+                    BOOST_LOG_SEV(logger, severity_t::info) << u8"File: " << local_file << u8" with hash: " << file_hash << u8" already has descriptors of all orders up to max_order = " << max_order << u8". Skip" << endl;
                 }
             }
         }
@@ -157,23 +177,81 @@ void parallel::recursive_compute(const boost::filesystem::path & input_dir, int
     BOOST_LOG_SEV(logger, severity_t::info) << u8"Completed" << endl;
 }
 
-void parallel::compute_descriptor(TasksQueue & queue, int max_order, std::atomic_bool & is_stop, sqlite::database & db)
+std::vector<int> parallel::serve_from_stored(const std::string & generic_path, const std::string & file_hash,
+    const std::vector<int> & missing_orders, sqlite::database & db)
+{
+    using namespace std;
+    using Descriptor = ZernikeDescriptor<DescriptorType, BitGrid::const_iterator>;
+
+    int stored_order{ 0 };
+    vector<DescriptorType> stored_invariants;
+
+    stringstream select_query;
+
+    select_query << u8"SELECT " << db::DbSchema::max_order_column() << ',' << db::DbSchema::descriptor_column()
+        << u8" FROM " << db::DbSchema::table_name()
+        << u8" WHERE " << db::DbSchema::path_column() << u8" = ? AND " << db::DbSchema::desc_value_size_bytes_column() << u8" = ?"
+        << u8" ORDER BY " << db::DbSchema::max_order_column() << u8" DESC LIMIT 1";
+
+    db << select_query.str()
+        << generic_path
+        << sizeof(DescriptorType)
+        >> [&stored_order, &stored_invariants](int order, vector<DescriptorType> invariants) -> void
+    {
+        stored_order = order;
+        stored_invariants = move(invariants);
+    };
+
+    vector<int> rest_orders;
+
+    sqldata::CollectionRows<DescriptorType> rows;
+
+    for (int order : missing_orders)
+    {
+        const size_t count{ Descriptor::GetInvariantCount(order) };
+
+        if (order < stored_order && count <= stored_invariants.size())
+        {
+            rows.emplace_row(generic_path, file_hash, vector<DescriptorType>(stored_invariants.cbegin(), stored_invariants.cbegin() + count), order);
+        }
+        else
+        {
+            rest_orders.push_back(order);
+        }
+    }
+
+    if (!rows.empty())
+    {
+        db << rows;
+
+        BOOST_LOG_SEV(logging::logger_main::get(), logging::severity_t::info) << u8"Sliced " << rows.size() << u8" descriptors of " << generic_path
+            << u8" from max_order = " << stored_order << endl;
+    }
+
+    return rest_orders;
+}
+
+void parallel::compute_descriptor(TasksQueue & queue, int max_order, MomentsEngine engine, std::size_t memory_limit, int wide_order, bool store_moments, std::size_t max_thread,
+    std::atomic_size_t & busy_workers, std::atomic_bool & is_stop, sqlite::database & db)
 {
     using namespace std;
     using namespace boost::filesystem;
     using namespace logging;
 
-    using VoxelType = bool;
-    using Container = vector<VoxelType>;
-    using DescriptorType = double;
+    // one bit per voxel, the moments are computed word by word
+    using Container = BitGrid;
+    using Descriptor = ZernikeDescriptor<DescriptorType, Container::const_iterator>;
+    using Moments = ZernikeMoments<Container::const_iterator, DescriptorType>;
+    using DirectMoments = DirectZernikeMoments<Container::const_iterator, DescriptorType>;
 
     Container binvox_voxels;
-    Container canonical_order_voxels;
+    vector<VoxelRun> binvox_runs;
+    vector<MeshTriangle> mesh_triangles;
     size_t dim{};
 
     logger_t & logger = logger_main::get();
 
-    tuple<path, path, string> path_to_voxel;
+    Task path_to_voxel;
 
     using Row = sqldata::Row<DescriptorType>;
 
@@ -181,10 +259,129 @@ void parallel::compute_descriptor(TasksQueue & queue, int max_order, std::atomic
 
     sqldata::CollectionRows < DescriptorType> rows;
 
+    // Zernike moments of several files are computed at once
+    const size_t batch_size{ 16 };
+
+    // Grids with at least this dimension are worth computing by several threads
+    const size_t large_grid_dim{ 256 };
+
+    vector<Descriptor> batch;
+    vector<Task> batch_paths;
+
+    Moments::ComplexT1D batch_zernike_moments;
+    Moments::T1D batch_geometrical_moments;
+
+    // the coefficient table is attached with the first batch, the direct engine needs none for grids
+    Moments zernike_moments;
+    bool is_table_attached{ false };
+
+    DirectMoments direct_moments(max_order);
+
+    // the wide moments are not batched, the batch is computed from moments rounded to double
+    const bool is_wide{ engine != MomentsEngine::direct && wide_order > 0 && max_order >= wide_order };
+
+    auto save_rows = [&]() -> bool
+    {
+        try
+        {
+            db << rows;
+            BOOST_LOG_SEV(logger, severity_t::info) << u8"Save invariants to database." << endl;
+        }
+        catch (const sqlite::sqlite_exception & exc)
+        {
+            BOOST_LOG_SEV(logger, severity_t::warning) << u8"Cannot save invariants to database." << exc.what() << endl << exc.get_extended_code() << endl << exc.get_sql() << endl;
+            is_stop = true;
+            return false;
+        }
+
+        rows.clear();
+
+        return true;
+    };
+
+    // one row per order of the task, the invariants of lower orders are a prefix of those of max_order
+    auto emplace_rows = [&](const Task & task, const Descriptor & descriptor) -> bool
+    {
+        const auto & invariants = descriptor.GetInvariants();
+
+        vector<unsigned char> moments;
+
+        if (store_moments)
+        {
+            descriptor.GetMomentsRecord().Write(moments);
+        }
+
+        for (int order : get<3>(task))
+        {
+            if (rows.size() >= rows_buffer_size && !save_rows())
+            {
+                return false;
+            }
+
+            const size_t count{ Descriptor::GetInvariantCount(order) };
+
+            rows.emplace_row(
+                get<1>(task).generic_string(),
+                get<2>(task),
+                Descriptor::T1D(invariants.cbegin(), invariants.cbegin() + count),
+                order,
+                order == max_order ? moments : vector<unsigned char>{});
+        }
+
+        return true;
+    };
+
+    auto flush_batch = [&]() -> bool
+    {
+        if (batch.empty())
+        {
+            return true;
+        }
+
+        batch_geometrical_moments.clear();
+
+        for (const auto & zd : batch)
+        {
+            const auto & moments = zd.GetGeometricalMoments();
+            batch_geometrical_moments.insert(batch_geometrical_moments.end(), moments.cbegin(), moments.cend());
+        }
+
+        if (!is_table_attached)
+        {
+            zernike_moments.Init(max_order);
+            is_table_attached = true;
+        }
+
+        zernike_moments.ComputeBatch(batch_geometrical_moments, batch.size(), batch_zernike_moments);
+
+        const size_t moments_per_object{ batch_zernike_moments.size() / batch.size() };
+
+        for (size_t i{ 0 }; i < batch.size(); i++)
+        {
+            batch[i].SetZernikeMoments(&batch_zernike_moments[i * moments_per_object]);
+
+            if (!emplace_rows(batch_paths[i], batch[i]))
+            {
+                return false;
+            }
+        }
+
+        batch.clear();
+        batch_paths.clear();
+
+        return true;
+    };
+
     while (true)
     {
         if (!queue.pop(path_to_voxel))
         {
+            // Do not keep computed geometrical moments waiting for new files
+            if (!flush_batch())
+            {
+                return;
+            }
+
             if (is_stop)
             {
                 break;
@@ -194,53 +391,90 @@ void parallel::compute_descriptor(TasksQueue & queue, int max_order, std::atomic
         }
         else
         {
+            BusyWorker busy_worker{ busy_workers };
+
             path absolute_path = get<0>(path_to_voxel) / get<1>(path_to_voxel);
 
             BOOST_LOG_SEV(logger, severity_t::debug) << u8"Processing " << absolute_path << endl;
 
-            if (!io::binvox::read_binvox(absolute_path, binvox_voxels, dim))
+            if (io::mesh::is_mesh_file(absolute_path))
+            {
+                // the moments of a mesh are integrated exactly over its triangles, there is no grid
+                if (!io::mesh::read_mesh(absolute_path, mesh_triangles))
+                {
+                    BOOST_LOG_SEV(logger, severity_t::warning) << u8"Cannot read mesh from " << absolute_path << endl;
+                }
+                else
+                {
+                    try
+                    {
+                        batch.emplace_back(mesh_triangles, max_order, false);
+                        batch_paths.push_back(path_to_voxel);
+                    }
+                    catch (const std::runtime_error & exc)
+                    {
+                        BOOST_LOG_SEV(logger, severity_t::warning) << u8"Cannot compute moments of " << absolute_path << u8": " << exc.what() << endl;
+                    }
+
+                    if (batch.size() >= batch_size && !flush_batch())
+                    {
+                        return;
+                    }
+                }
+            }
+            else if (!io::binvox::read_binvox_runs(absolute_path, binvox_runs, dim))
             {
                 BOOST_LOG_SEV(logger, severity_t::warning) << u8"Cannot read binvox from " << absolute_path << endl;
             }
             else
             {
-                canonical_order_voxels.resize(binvox_voxels.size());
-                binvox::utils::convert_to_canonical_order(binvox_voxels.begin(), canonical_order_voxels.begin(), dim);
+                // A large grid takes over the threads of idle workers if there are no more files for them
+                unsigned object_threads{ 1 };
 
-                // compute the zernike descriptors
-                // This invoke changes voxels data
-                ZernikeDescriptor<DescriptorType, Container::iterator> zd(canonical_order_voxels.begin(), dim, max_order);
+                if ((engine != MomentsEngine::runs || is_wide) && dim >= large_grid_dim && queue.empty())
+                {
+                    size_t busy{ busy_workers.load() };
+                    object_threads = static_cast<unsigned>(max_thread > busy ? max_thread - busy + 1 : 1);
 
-                auto invs{ zd.get_invariants() };
+                    BOOST_LOG_SEV(logger, severity_t::debug) << u8"Computing " << absolute_path << u8" with " << object_threads << u8" threads" << endl;
+                }
 
-                if (rows.size() < rows_buffer_size)
+                if (engine == MomentsEngine::direct || is_wide)
                 {
-                    rows.emplace_row(
-                        get<1>(path_to_voxel).generic_string(),
-                        get<2>(path_to_voxel),
-                        invs,
-                        max_order);
+                    // the Zernike moments are computed right away, the descriptor bypasses the batch
+                    io::binvox::runs_to_bit_grid(binvox_runs, binvox_voxels, dim);
+
+                    Descriptor descriptor = is_wide ?
+                        Descriptor(binvox_voxels.cbegin(), dim, max_order, true, object_threads, VoxelLayout::Binvox(), memory_limit, wide_order) :
+                        Descriptor(binvox_voxels.cbegin(), dim, direct_moments, object_threads, VoxelLayout::Binvox());
+
+                    if (!emplace_rows(path_to_voxel, descriptor))
+                    {
+                        return;
+                    }
                 }
                 else
                 {
-                    try
+                    if (engine == MomentsEngine::runs)
                     {
-                        db << rows;
-                        BOOST_LOG_SEV(logger, severity_t::info) << u8"Save invariants to database." << endl;
+                        // the runs are integrated directly, the voxels are never expanded
+                        batch.emplace_back(binvox_runs, dim, max_order, false);
                     }
-                    catch (const sqlite::sqlite_exception & exc)
+                    else
                     {
-                        BOOST_LOG_SEV(logger, severity_t::warning) << u8"Cannot save invariants to database." << exc.what() << endl << exc.get_extended_code() << endl << exc.get_sql() << endl;
-                        is_stop = true;
-                        return;
+                        // the grid is kept in the binvox order and read along its memory axes
+                        io::binvox::runs_to_bit_grid(binvox_runs, binvox_voxels, dim);
+
+                        // compute the geometrical moments, the zernike descriptors are computed for the whole batch
+                        batch.emplace_back(binvox_voxels.cbegin(), dim, max_order, false, object_threads, VoxelLayout::Binvox(), memory_limit);
                     }
 
-                    rows.clear();
-                    rows.emplace_row(
-                        get<1>(path_to_voxel).generic_string(),
-                        get<2>(path_to_voxel),
-                        invs,
-                        max_order);
+                    batch_paths.push_back(path_to_voxel);
+
+                    if (batch.size() >= batch_size && !flush_batch())
+                    {
+                        return;
+                    }
                 }
             }
         }
@@ -249,16 +483,6 @@ void parallel::compute_descriptor(TasksQueue & queue, int max_order, std::atomic
     // Rest items
     if (!rows.empty())
     {
-        try
-        {
-            db << rows;
-            BOOST_LOG_SEV(logger, severity_t::info) << u8"Save invariants to database." << endl;
-        }
-        catch (const sqlite::sqlite_exception & exc)
-        {
-            BOOST_LOG_SEV(logger, severity_t::warning) << u8"Cannot save invariants to database." << exc.what() << endl << exc.get_extended_code() << endl << exc.get_sql() << endl;
-            is_stop = true;
-            return;
-        }
+        save_rows();
     }
 }
\ No newline at end of file
@@ -66,6 +66,19 @@ namespace cliargs
     constexpr const char * log_sett_short_arh_name{ u8"l" };
     constexpr const char * db_arg_name{ u8"output-db" };
     constexpr const char * db_short_arg_name{ u8"o" };
+    constexpr const char * cache_arg_name{ u8"coeff-cache" };
+    constexpr const char * cache_short_arg_name{ u8"c" };
+    constexpr const char * engine_arg_name{ u8"engine" };
+    constexpr const char * engine_short_arg_name{ u8"e" };
+    constexpr const char * engine_runs{ u8"runs" };
+    constexpr const char * engine_dense{ u8"dense" };
+    constexpr const char * engine_direct{ u8"direct" };
+    constexpr const char * memory_arg_name{ u8"memory-limit" };
+    constexpr const char * memory_short_arg_name{ u8"m" };
+    constexpr const char * wide_order_arg_name{ u8"wide-order" };
+    constexpr const char * wide_order_short_arg_name{ u8"w" };
+    constexpr const char * moments_arg_name{ u8"store-moments" };
+    constexpr const char * moments_short_arg_name{ u8"r" };
 }
 
 bool init_logg_settings_from_file(const boost::filesystem::path & path_to_config)
@@ -102,6 +115,73 @@ bool init_logg_settings_from_file(const boost::filesystem::path & path_to_config
     return true;
 }
 
+// Parses a comma separated list of orders, e.g. 10,20,30. The orders are sorted and duplicates are removed.
+bool parse_orders(const std::string & list, std::vector<int> & orders)
+{
+    orders.clear();
+
+    std::istringstream tokens{ list };
+    std::string token;
+
+    while (std::getline(tokens, token, ','))
+    {
+        std::size_t end{ 0 };
+        int order{ 0 };
+
+        try
+        {
+            order = std::stoi(token, &end);
+        }
+        catch (const std::logic_error &)
+        {
+            return false;
+        }
+
+        if (token.find_first_not_of(u8" \t", end) != std::string::npos)
+        {
+            return false;
+        }
+
+        orders.push_back(order);
+    }
+
+    std::sort(orders.begin(), orders.end());
+    orders.erase(std::unique(orders.begin(), orders.end()), orders.end());
+
+    return !orders.empty();
+}
+
+// Per-user directory of the cached coefficient tables: %LOCALAPPDATA%\zernike3d on Windows,
+// $XDG_CACHE_HOME/zernike3d or ~/.cache/zernike3d elsewhere. Empty if none is known,
+// the cache is disabled then. A shared directory like /tmp would let other users plant tables.
+boost::filesystem::path default_cache_directory()
+{
+#ifdef _WIN32
+    const char * local_app_data{ std::getenv("LOCALAPPDATA") };
+
+    if (local_app_data != nullptr && *local_app_data != '\0')
+    {
+        return boost::filesystem::path{ local_app_data } / u8"zernike3d";
+    }
+#else
+    const char * cache_home{ std::getenv("XDG_CACHE_HOME") };
+
+    if (cache_home != nullptr && *cache_home == '/')
+    {
+        return boost::filesystem::path{ cache_home } / u8"zernike3d";
+    }
+
+    const char * home{ std::getenv("HOME") };
+
+    if (home != nullptr && *home == '/')
+    {
+        return boost::filesystem::path{ home } / u8".cache" / u8"zernike3d";
+    }
+#endif
+
+    return {};
+}
+
 auto parse_cli_args(int argc, char ** argv)
 {
     using std::string;
@@ -132,15 +212,42 @@ auto parse_cli_args(int argc, char ** argv)
     db_arg += ',';
     db_arg += db_short_arg_name;
 
+    string cache_arg{ cache_arg_name };
+    cache_arg += ',';
+    cache_arg += cache_short_arg_name;
+
+    string engine_arg{ engine_arg_name };
+    engine_arg += ',';
+    engine_arg += engine_short_arg_name;
+
+    string memory_arg{ memory_arg_name };
+    memory_arg += ',';
+    memory_arg += memory_short_arg_name;
+
+    string wide_order_arg{ wide_order_arg_name };
+    wide_order_arg += ',';
+    wide_order_arg += wide_order_short_arg_name;
+
+    string moments_arg{ moments_arg_name };
+    moments_arg += ',';
+    moments_arg += moments_short_arg_name;
+
+    string default_cache_dir{ default_cache_directory().string() };
+
     options_description desc{ u8"Program options for descriptors. Create XML file with descriptors for each binvox in input directory.\nSee: Novotni M., Klein R. 3D zernike descriptors for content based shape retrieval New York, New York, USA: ACM Press, 2003. 216 c." };
     desc.add_options()
-        (u8"help,h", u8"-d path_to_directory -n max_order")
+        (u8"help,h", u8"-d path_to_directory -n max_order[,max_order...]")
         (dir.c_str(), value<string>(), u8"Path to directory with .binvox files.")
-        (order.c_str(), value<int>(), u8"Maximum order of Zernike moments. N in original paper.")
+        (order.c_str(), value<string>(), u8"Maximum order of Zernike moments. N in original paper. A comma separated list (e.g. 10,20,30) stores a descriptor for each order, the moments are computed once for the largest one. Lower orders are sliced from descriptors of higher orders that are already in the database without reading the files.")
         (thread_arg.c_str(), value<int>()->default_value(2), u8"Maximum number of threads for descriptor computing.")
         (queue_arg.c_str(), value<int>()->default_value(500), u8"Maximum size of queue of file paths when recursive scanning directory. If size of queue is greater than parameter then scanning thread sleeps.")
         (log_arg.c_str(), value<string>()->default_value(u8"logsettings.ini"), u8"Path to file with log config. See https://www.boost.org/doc/libs/1_72_0/libs/log/doc/html/log/detailed/utilities.html#log.detailed.utilities.setup.settings_file")
         (db_arg.c_str(), value<string>()->default_value(u8"descriptors.sqlite"), u8"Path to database to store descriptors")
+        (cache_arg.c_str(), value<string>()->default_value(default_cache_dir), u8"Path to directory with cached tables of coefficients. Tables are memory-mapped and shared between processes. A new directory is created accessible only by the current user, tables in directories or files writable by other users are ignored. Empty string disables the cache.")
+        (engine_arg.c_str(), value<string>()->default_value(engine_runs), u8"Engine for moments: 'runs' integrates run-length encoded binvox data directly, 'dense' expands it to voxels, 'direct' evaluates the Zernike polynomials on the voxels without geometrical moments (slower, but accurate at high orders).")
+        (memory_arg.c_str(), value<int>()->default_value(0), u8"Maximum memory in MiB for the working buffers of the dense engine per grid. Larger grids are processed in slabs. 0 means no limit.")
+        (moments_arg.c_str(), bool_switch(), u8"Store the complex Zernike moments, the center of gravity and the scale of the maximum order with the invariants, so other invariants or reconstructions do not need the voxels. At order 20 the moments take 16 times the space of the invariants.")
+        (wide_order_arg.c_str(), value<int>()->default_value(0), u8"If the maximum order reaches this one, the geometrical moments and the Zernike moments of this order and above are computed in long double (3-4 times slower, accurate to double at high orders). The runs engine expands the voxels for that. 0 disables it. Ignored by the direct engine.")
         ;
 
     variables_map vm;
@@ -183,11 +290,17 @@ bool validate_args(const boost::program_options::variables_map & args, const boo
     }
 
     {
-        int max_order{ args[order_arg_name].as<int>() };
+        std::vector<int> orders;
+
+        if (!parse_orders(args[order_arg_name].as<string>(), orders))
+        {
+            cerr << u8"Cannot parse the list of maximum orders " << args[order_arg_name].as<string>() << endl;
+            return false;
+        }
 
-        if (max_order <= 0)
+        if (orders.front() <= 0)
         {
-            cerr << u8"Maximum order must be positive. Actual value is " << max_order << endl;
+            cerr << u8"Maximum order must be positive. Actual value is " << orders.front() << endl;
             return false;
         }
     }
@@ -235,6 +348,57 @@ bool validate_args(const boost::program_options::variables_map & args, const boo
         }
     }
 
+    {
+        path cache_dir{ args[cache_arg_name].as<string>() };
+
+        if (!cache_dir.empty())
+        {
+            boost::system::error_code error;
+
+            if (!exists(cache_dir, error) && create_directories(cache_dir, error))
+            {
+                // the tables are trusted, no other user may write there
+                permissions(cache_dir, boost::filesystem::owner_all, error);
+            }
+
+            if (status(cache_dir).type() != file_type::directory_file)
+            {
+                cerr << cache_dir << u8" is not directory or cannot be created." << endl;
+                return false;
+            }
+        }
+    }
+
+    {
+        string engine{ args[engine_arg_name].as<string>() };
+
+        if (engine != engine_runs && engine != engine_dense && engine != engine_direct)
+        {
+            cerr << u8"Unknown engine " << engine << u8". Expected " << engine_runs << u8", " << engine_dense << u8" or " << engine_direct << endl;
+            return false;
+        }
+    }
+
+    {
+        int memory_limit{ args[memory_arg_name].as<int>() };
+
+        if (memory_limit < 0)
+        {
+            cerr << u8"Memory limit must not be negative. Actual value is " << memory_limit << endl;
+            return false;
+        }
+    }
+
+    {
+        int wide_order{ args[wide_order_arg_name].as<int>() };
+
+        if (wide_order < 0)
+        {
+            cerr << u8"Wide order must not be negative. Actual value is " << wide_order << endl;
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -285,10 +449,25 @@ int main(int argc, char ** argv)
     }
 
     path input_directory{ args[dir_arg_name].as<string>() };
-    int max_order{ args[order_arg_name].as<int>() };
+    std::vector<int> orders;
+    parse_orders(args[order_arg_name].as<string>(), orders);
     int queue_size{ args[queue_arg_name].as<int>() };
     int thread_count{ args[thread_arg_name].as<int>() };
     path db_path{ args[db_arg_name].as<string>() };
+    path cache_dir{ args[cache_arg_name].as<string>() };
+    parallel::MomentsEngine engine{ parallel::MomentsEngine::runs };
+
+    if (args[engine_arg_name].as<string>() == engine_dense)
+    {
+        engine = parallel::MomentsEngine::dense;
+    }
+    else if (args[engine_arg_name].as<string>() == engine_direct)
+    {
+        engine = parallel::MomentsEngine::direct;
+    }
+    std::size_t memory_limit{ static_cast<std::size_t>(args[memory_arg_name].as<int>()) << 20 };
+    int wide_order{ args[wide_order_arg_name].as<int>() };
+    bool store_moments{ args[moments_arg_name].as<bool>() };
 
     logging::logger_t & logger = logging::logger_main::get();
 
@@ -303,7 +482,10 @@ int main(int argc, char ** argv)
 
         db::DbSchema::init_db(db);
 
-        parallel::recursive_compute(input_directory, max_order, queue_size, thread_count, db);
+        ZernikeCoefficients<parallel::DescriptorType>::SetCacheDirectory(cache_dir);
+        ZernikeCoefficients<parallel::WideType>::SetCacheDirectory(cache_dir);
+
+        parallel::recursive_compute(input_directory, orders, queue_size, thread_count, engine, memory_limit, wide_order, store_moments, db);
 
         clear();
     }
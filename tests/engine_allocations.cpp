@@ -0,0 +1,98 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++, C#, and Java: http://www.viva64.com
+
+// ZernikeEngine computes grids no larger than the ones before without any heap
+// allocation (see ZernikeEngine). The global operator new counts the allocations.
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "ZernikeEngine.hpp"
+
+namespace
+{
+    std::atomic_size_t allocations{ 0 };
+}
+
+void * operator new(std::size_t size)
+{
+    ++allocations;
+
+    if (void * memory = std::malloc(size == 0 ? 1 : size))
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void * memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void * memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+int main()
+{
+    using Voxels = std::vector<unsigned char>;
+    using Engine = ZernikeEngine<double, Voxels::const_iterator>;
+
+    const std::size_t dim{ 48 };
+    const std::size_t order{ 20 };
+    const int passes{ 3 };
+
+    // an ellipsoid with a hole
+    Voxels voxels(dim * dim * dim, 0);
+
+    for (std::size_t z = 0; z < dim; ++z)
+    {
+        for (std::size_t y = 0; y < dim; ++y)
+        {
+            for (std::size_t x = 0; x < dim; ++x)
+            {
+                long dx = static_cast<long>(x) - 24, dy = static_cast<long>(y) - 22, dz = static_cast<long>(z) - 25;
+                long r = dx * dx + 2 * dy * dy + 3 * dz * dz;
+
+                voxels[(z * dim + y) * dim + x] = r < 400 && r > 40 ? 1 : 0;
+            }
+        }
+    }
+
+    Engine engine;
+    std::vector<double> invariants(Engine::GetInvariantCount(order));
+    std::vector<double> first;
+
+    // the first pass grows the buffers and attaches the coefficient table
+    engine.Compute(voxels.cbegin(), dim, order, invariants.data(), invariants.size());
+    first = invariants;
+
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        std::size_t before = allocations.load();
+
+        engine.Compute(voxels.cbegin(), dim, order, invariants.data(), invariants.size());
+
+        std::size_t count = allocations.load() - before;
+
+        if (count != 0)
+        {
+            std::cerr << "Pass " << pass << " allocated " << count << " times" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (invariants != first)
+        {
+            std::cerr << "Pass " << pass << " computed other invariants" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}